@@ -64,6 +64,8 @@
 static const unsigned ABL_MIN_LEN=2;
 static const int ABL_SIZE_LIMIT = 5000;       /* full list   */
 static const int ABL_SIZE_LIMIT_LOOKUP = 50; /* quick lookup */
+/* reuse a complete alias completion result for this many seconds */
+static const gint64 ABL_COMPLETION_TTL = 300;
 /* Which parameters do we want back? */
 static char* book_attrs[] = {
     "cn",        /* maps to displayed name */
@@ -147,8 +149,23 @@ struct _LibBalsaAddressBookLdap {
     gboolean enable_tls;
 
     LDAP *directory;
+
+    /* The last complete alias completion result, of LbablCompletion;
+     * completions for a longer prefix are filtered from it. */
+    gchar *completion_prefix;
+    GList *completion_cache;
+    gint64 completion_time;
 };
 
+/* A directory entry found by alias completion: all its cn, sn and mail
+ * values, case-folded, and one address per mail value. */
+typedef struct {
+    gchar **cn;
+    gchar **sn;
+    gchar **mail;
+    GList *addresses;           /* of InternetAddress */
+} LbablCompletion;
+
 G_DEFINE_TYPE(LibBalsaAddressBookLdap, libbalsa_address_book_ldap,
         LIBBALSA_TYPE_ADDRESS_BOOK)
 
@@ -189,6 +206,8 @@ libbalsa_address_book_ldap_init(LibBalsaAddressBookLdap * ab_ldap)
     ab_ldap->passwd  = NULL;
     ab_ldap->enable_tls = FALSE;
     ab_ldap->directory = NULL;
+    ab_ldap->completion_prefix = NULL;
+    ab_ldap->completion_cache = NULL;
     libbalsa_address_book_set_is_expensive(LIBBALSA_ADDRESS_BOOK(ab_ldap), TRUE);
 }
 
@@ -243,6 +262,26 @@ libbalsa_address_book_ldap_new(const gchar *name, const gchar *host,
     return ab;
 }
 
+static void
+lbabl_completion_free(LbablCompletion * completion)
+{
+    g_strfreev(completion->cn);
+    g_strfreev(completion->sn);
+    g_strfreev(completion->mail);
+    g_list_free_full(completion->addresses, g_object_unref);
+    g_free(completion);
+}
+
+static void
+lbabl_completion_cache_clear(LibBalsaAddressBookLdap * ab_ldap)
+{
+    g_free(ab_ldap->completion_prefix);
+    ab_ldap->completion_prefix = NULL;
+    g_list_free_full(ab_ldap->completion_cache,
+                     (GDestroyNotify) lbabl_completion_free);
+    ab_ldap->completion_cache = NULL;
+}
+
 /*
  * Close the ldap connection....
  */
@@ -253,6 +292,7 @@ libbalsa_address_book_ldap_close_connection(LibBalsaAddressBookLdap * ab_ldap)
 	ldap_unbind_ext(ab_ldap->directory, NULL, NULL);
 	ab_ldap->directory = NULL;
     }
+    lbabl_completion_cache_clear(ab_ldap);
 }
 
 /*
@@ -594,8 +634,38 @@ libbalsa_address_book_ldap_get_address(LibBalsaAddressBook * ab,
     return address;
 }
 
+static gchar *
+lbabl_casefold(const gchar * str)
+{
+    gchar *normalized;
+    gchar *folded;
+
+    if (str == NULL)
+        return NULL;
+
+    normalized = g_utf8_normalize(str, -1, G_NORMALIZE_ALL);
+    if (normalized == NULL)     /* not valid UTF-8 */
+        return NULL;
+    folded = g_utf8_casefold(normalized, -1);
+    g_free(normalized);
+
+    return folded;
+}
+
+static void
+lbabl_add_casefolded(GPtrArray * values, const struct berval *val)
+{
+    gchar *str = g_strndup(val->bv_val, val->bv_len);
+    gchar *folded = lbabl_casefold(str);
+
+    if (folded != NULL)
+        g_ptr_array_add(values, folded);
+    g_free(str);
+}
+
+/* Prepend the completion for the entry to the list of LbablCompletion. */
 static GList *
-lbabl_get_internet_address(GList *addrs, LDAP *dir, LDAPMessage * e)
+lbabl_get_completions(GList *completions, LDAP *dir, LDAPMessage * e)
 {
     BerElement *ber = NULL;
     char *attr;
@@ -604,6 +674,10 @@ lbabl_get_internet_address(GList *addrs, LDAP *dir, LDAPMessage * e)
     GList *email = NULL;
     GList *p;
     gchar *sn = NULL, *cn = NULL, *first = NULL;
+    GPtrArray *cn_values = g_ptr_array_new();
+    GPtrArray *sn_values = g_ptr_array_new();
+    GPtrArray *mail_values = g_ptr_array_new();
+    LbablCompletion *completion;
 
     for (attr = ldap_first_attribute(dir, e, &ber);
 	 attr != NULL; 
@@ -613,14 +687,22 @@ lbabl_get_internet_address(GList *addrs, LDAP *dir, LDAPMessage * e)
 	 */
 	if ((vals = ldap_get_values_len(dir, e, attr)) != NULL) {
 	    for (i = 0; vals[i] != NULL; i++) {
-		if ((g_ascii_strcasecmp(attr, "sn") == 0) && (!sn))
-		    sn = g_strndup(vals[i]->bv_val, vals[i]->bv_len);
-		if ((g_ascii_strcasecmp(attr, "cn") == 0) && (!cn))
-		    cn = g_strndup(vals[i]->bv_val, vals[i]->bv_len);
+		if (g_ascii_strcasecmp(attr, "sn") == 0) {
+		    if (!sn)
+		        sn = g_strndup(vals[i]->bv_val, vals[i]->bv_len);
+		    lbabl_add_casefolded(sn_values, vals[i]);
+		}
+		if (g_ascii_strcasecmp(attr, "cn") == 0) {
+		    if (!cn)
+		        cn = g_strndup(vals[i]->bv_val, vals[i]->bv_len);
+		    lbabl_add_casefolded(cn_values, vals[i]);
+		}
 		if ((g_ascii_strcasecmp(attr, "givenName") == 0) && (!first))
 		    first = g_strndup(vals[i]->bv_val, vals[i]->bv_len);
-		if (g_ascii_strcasecmp(attr, "mail") == 0)
+		if (g_ascii_strcasecmp(attr, "mail") == 0) {
 		    email = g_list_prepend(email, g_strndup(vals[i]->bv_val, vals[i]->bv_len));
+		    lbabl_add_casefolded(mail_values, vals[i]);
+		}
 	    }
 	    ldap_value_free_len(vals);
 	}
@@ -630,14 +712,65 @@ lbabl_get_internet_address(GList *addrs, LDAP *dir, LDAPMessage * e)
 
     if(!cn)
         cn = create_name(first, sn);
+
+    completion = g_new(LbablCompletion, 1);
+    g_ptr_array_add(cn_values, NULL);
+    completion->cn = (gchar **) g_ptr_array_free(cn_values, FALSE);
+    g_ptr_array_add(sn_values, NULL);
+    completion->sn = (gchar **) g_ptr_array_free(sn_values, FALSE);
+    g_ptr_array_add(mail_values, NULL);
+    completion->mail = (gchar **) g_ptr_array_free(mail_values, FALSE);
+    completion->addresses = NULL;
     for (p = email; p != NULL; p = p->next) {
-    	addrs = g_list_prepend(addrs, internet_address_mailbox_new(cn, (const gchar *) p->data));
+    	completion->addresses =
+            g_list_prepend(completion->addresses,
+                           internet_address_mailbox_new(cn, (const gchar *) p->data));
     }
+    completions = g_list_prepend(completions, completion);
+
     g_list_free_full(email, g_free);
     g_free(sn); g_free(cn); g_free(first);
 
-    return addrs;
+    return completions;
+}
+
+static gboolean
+lbabl_values_match(gchar ** values, const gchar * prefix, gboolean is_mail)
+{
+    for (; *values != NULL; values++) {
+        if (g_str_has_prefix(*values, prefix)
+            && (!is_mail || strchr(*values + strlen(prefix), '@') != NULL))
+            return TRUE;
+    }
+
+    return FALSE;
 }
+
+/* Does the entry match the LDAP filter used for the prefix,
+ * i.e. (|(cn=prefix*)(sn=prefix*)(mail=prefix*@*))?  As on the server,
+ * any value of the attributes may match. */
+static gboolean
+lbabl_completion_matches(const LbablCompletion * completion,
+                         const gchar * prefix)
+{
+    return lbabl_values_match(completion->cn, prefix, FALSE)
+        || lbabl_values_match(completion->sn, prefix, FALSE)
+        || lbabl_values_match(completion->mail, prefix, TRUE);
+}
+
+/* Prepend all addresses of the entry to the list of InternetAddress. */
+static GList *
+lbabl_completion_prepend_addresses(GList * res,
+                                   const LbablCompletion * completion)
+{
+    GList *list;
+
+    for (list = completion->addresses; list != NULL; list = list->next)
+        res = g_list_prepend(res, g_object_ref(list->data));
+
+    return res;
+}
+
 /*
  * create_name()
  *
@@ -686,6 +819,7 @@ libbalsa_address_book_ldap_add_address(LibBalsaAddressBook *ab,
     addr = libbalsa_address_get_addr(address);
     g_return_val_if_fail(addr != NULL, LBABERR_CANNOT_WRITE);
 
+    lbabl_completion_cache_clear(ab_ldap);
     if (ab_ldap->directory == NULL) {
         if(libbalsa_address_book_ldap_open_connection(ab_ldap) != LDAP_SUCCESS)
 	    return LBABERR_CANNOT_CONNECT;
@@ -774,6 +908,7 @@ libbalsa_address_book_ldap_remove_address(LibBalsaAddressBook *ab,
     addr = libbalsa_address_get_addr(address);
     g_return_val_if_fail(addr != NULL, LBABERR_CANNOT_WRITE);
 
+    lbabl_completion_cache_clear(ab_ldap);
     if (ab_ldap->directory == NULL) {
         if (libbalsa_address_book_ldap_open_connection(ab_ldap) != LDAP_SUCCESS)
 	    return LBABERR_CANNOT_CONNECT;
@@ -837,6 +972,7 @@ libbalsa_address_book_ldap_modify_address(LibBalsaAddressBook *ab,
     new_addr = libbalsa_address_get_addr(newval);
     g_return_val_if_fail(new_addr != NULL, LBABERR_CANNOT_WRITE);
 
+    lbabl_completion_cache_clear(ab_ldap);
     if(!STREQ(addr, new_addr)) {
         /* email address has changed, we have to remove old entry and
          * add a new one. */
@@ -1143,6 +1279,38 @@ rfc_2254_escape(const gchar *raw)
 }
 
 
+/* Filter the cached result of a previous completion, if it is still
+ * fresh and its prefix is a prefix of the requested one.  A longer
+ * prefix can only narrow the LDAP filter, and the cache holds only
+ * results which were not truncated by a size limit. */
+static gboolean
+lbabl_completion_from_cache(LibBalsaAddressBookLdap * ab_ldap,
+                            const gchar * prefix, GList ** res)
+{
+    GList *list;
+
+    if (ab_ldap->completion_prefix == NULL ||
+        !g_str_has_prefix(prefix, ab_ldap->completion_prefix))
+        return FALSE;
+
+    if (g_get_monotonic_time() - ab_ldap->completion_time >
+        ABL_COMPLETION_TTL * G_USEC_PER_SEC) {
+        lbabl_completion_cache_clear(ab_ldap);
+        return FALSE;
+    }
+
+    *res = NULL;
+    for (list = ab_ldap->completion_cache; list != NULL; list = list->next) {
+        LbablCompletion *completion = list->data;
+
+        if (lbabl_completion_matches(completion, prefix))
+            *res = lbabl_completion_prepend_addresses(*res, completion);
+    }
+    *res = g_list_reverse(*res);
+
+    return TRUE;
+}
+
 static GList *
 libbalsa_address_book_ldap_alias_complete(LibBalsaAddressBook * ab,
 					  const gchar * prefix)
@@ -1150,6 +1318,9 @@ libbalsa_address_book_ldap_alias_complete(LibBalsaAddressBook * ab,
     static struct timeval timeout = { 15, 0 }; /* 15 sec timeout */
     LibBalsaAddressBookLdap *ab_ldap;
     GList *res = NULL;
+    GList *completions = NULL;
+    GList *list;
+    gchar *prefix_f;
     gchar* filter;
     gchar* ldap;
     int rc;
@@ -1160,9 +1331,17 @@ libbalsa_address_book_ldap_alias_complete(LibBalsaAddressBook * ab,
     if (!libbalsa_address_book_get_expand_aliases(ab) || strlen(prefix) < ABL_MIN_LEN)
         return NULL;
 
+    prefix_f = lbabl_casefold(prefix);
+    if (prefix_f != NULL && lbabl_completion_from_cache(ab_ldap, prefix_f, &res)) {
+        g_free(prefix_f);
+        return res;
+    }
+
     if (ab_ldap->directory == NULL) {
-        if (libbalsa_address_book_ldap_open_connection(ab_ldap) != LDAP_SUCCESS)
+        if (libbalsa_address_book_ldap_open_connection(ab_ldap) != LDAP_SUCCESS) {
+            g_free(prefix_f);
 	    return NULL;
+        }
     }
 
     /*
@@ -1189,7 +1368,7 @@ libbalsa_address_book_ldap_alias_complete(LibBalsaAddressBook * ab,
 	if (result)
 	    for(e = ldap_first_entry(ab_ldap->directory, result);
 		e != NULL; e = ldap_next_entry(ab_ldap->directory, e)) {
-		res = lbabl_get_internet_address(res, ab_ldap->directory, e);
+		completions = lbabl_get_completions(completions, ab_ldap->directory, e);
 	    }
     case LDAP_SIZELIMIT_EXCEEDED:
     case LDAP_TIMELIMIT_EXCEEDED:
@@ -1221,7 +1400,22 @@ libbalsa_address_book_ldap_alias_complete(LibBalsaAddressBook * ab,
     g_debug("ldap_alias_complete:: result=%p", result);
     if(result) ldap_msgfree(result);
 
-    if(res) res = g_list_reverse(res);
+    completions = g_list_reverse(completions);
+    for (list = completions; list != NULL; list = list->next) {
+        res = lbabl_completion_prepend_addresses(res, list->data);
+    }
+    res = g_list_reverse(res);
+
+    /* remember a complete result for longer prefixes */
+    if (rc == LDAP_SUCCESS && prefix_f != NULL) {
+        lbabl_completion_cache_clear(ab_ldap);
+        ab_ldap->completion_prefix = prefix_f;
+        ab_ldap->completion_cache = completions;
+        ab_ldap->completion_time = g_get_monotonic_time();
+    } else {
+        g_free(prefix_f);
+        g_list_free_full(completions, (GDestroyNotify) lbabl_completion_free);
+    }
 
     return res;
 }
@@ -85,6 +85,7 @@ typedef struct {
     GSList *item_list;
 
     time_t mtime;
+    off_t size;
 
     LibBalsaCompletion *name_complete;
 } LibBalsaAddressBookTextPrivate;
@@ -145,11 +146,13 @@ libbalsa_address_book_text_init(LibBalsaAddressBookText * ab_text)
     priv->path = NULL;
     priv->item_list = NULL;
     priv->mtime = 0;
+    priv->size = 0;
 
     priv->name_complete =
         libbalsa_completion_new((LibBalsaCompletionFunc)
                                 completion_data_extract);
     libbalsa_completion_set_compare(priv->name_complete, strncmp_word);
+    libbalsa_completion_set_word_index(priv->name_complete, TRUE);
 }
 
 static LibBalsaAddressBookTextItem *
@@ -183,7 +186,8 @@ libbalsa_address_book_text_finalize(GObject * object)
 
 /* Load helpers */
 
-/* returns true if the book has changed or there is an error */
+/* returns true if the book has changed or there is an error; the time
+ * stamp and size are updated by lbab_text_load_file() */
 static gboolean
 lbab_text_address_book_need_reload(LibBalsaAddressBookText * ab_text)
 {
@@ -194,12 +198,7 @@ lbab_text_address_book_need_reload(LibBalsaAddressBookText * ab_text)
     if (stat(priv->path, &stat_buf) == -1)
         return TRUE;
 
-    if (stat_buf.st_mtime > priv->mtime) {
-        priv->mtime = stat_buf.st_mtime;
-        return TRUE;
-    }
-
-    return FALSE;
+    return (stat_buf.st_mtime != priv->mtime) || (stat_buf.st_size != priv->size);
 }
 
 /* Case-insensitive utf-8 string-has-prefix */
@@ -290,6 +289,7 @@ lbab_text_load_file(LibBalsaAddressBookText * ab_text, FILE * stream)
     GSList *list = NULL;
     GList *completion_list = NULL;
     CompletionData *cmp_data;
+    struct stat stat_buf;
 #if MAKE_GROUP_BY_ORGANIZATION
     GHashTable *group_table;
 #endif                          /* MAKE_GROUP_BY_ORGANIZATION */
@@ -297,6 +297,14 @@ lbab_text_load_file(LibBalsaAddressBookText * ab_text, FILE * stream)
     if (!lbab_text_address_book_need_reload(ab_text))
         return TRUE;
 
+    /* remember the state of the file we are about to parse */
+    if (fstat(fileno(stream), &stat_buf) == 0) {
+        priv->mtime = stat_buf.st_mtime;
+        priv->size = stat_buf.st_size;
+    } else {
+        priv->mtime = 0;
+    }
+
     g_slist_free_full(priv->item_list, ab_text_class->text_item_free_func);
     priv->item_list = NULL;
 
@@ -722,19 +730,22 @@ libbalsa_address_book_text_alias_complete(LibBalsaAddressBook * ab,
     if (!libbalsa_address_book_get_expand_aliases(ab))
         return NULL;
 
-    stream = fopen(priv->path, "r");
-    if (!stream)
-        return NULL;
+    /* Reuse the completion data unless the file has changed. */
+    if (lbab_text_address_book_need_reload(ab_text)) {
+        stream = fopen(priv->path, "r");
+        if (!stream)
+            return NULL;
 
-    if (!lbab_text_lock_book(ab_text, stream, FALSE)) {
-        fclose(stream);
-        return NULL;
-    }
+        if (!lbab_text_lock_book(ab_text, stream, FALSE)) {
+            fclose(stream);
+            return NULL;
+        }
 
-    lbab_text_load_file(ab_text, stream);
+        lbab_text_load_file(ab_text, stream);
 
-    lbab_text_unlock_book(ab_text, stream);
-    fclose(stream);
+        lbab_text_unlock_book(ab_text, stream);
+        fclose(stream);
+    }
 
     for (list =
          libbalsa_completion_complete(priv->name_complete,
@@ -50,9 +50,12 @@
  * fingerprint: the fingerprint of pubkey, stored to avoid frequently importing pubkey into a temporary context
  * expires: the expiry time of pubkey (0 for never), stored to avoid frequently importing pubkey into a temporary context
  * prefer_encrypt: TRUE (1) if the prefer-encrypt=mutual attribute was given in the latest Autocrypt header
+ * keyid: the key ID (last 16 hex digits) of the upper-case fingerprint, indexed for fast key lookups
  *
  * notes: SQLite stores BOOLEAN as INTEGER
- *        We do not support key gossip, so storing everything in a flat table is sufficient */
+ *        We do not support key gossip, so storing everything in a flat table is sufficient
+ *        The schema version is stored as user_version; DB_MIGRATE_1 updates version 0 databases */
+#define DB_SCHEMA_VERSION						1
 #define DB_SCHEMA								\
 	"PRAGMA auto_vacuum = 1;"					\
 	"CREATE TABLE autocrypt("					\
@@ -62,10 +65,24 @@
 		"pubkey BLOB NOT NULL, "				\
 		"fingerprint TEXT NOT NULL, "			\
 		"expires BIGINT NOT NULL, "				\
-		"prefer_encrypt BOOLEAN DEFAULT 0);"
+		"prefer_encrypt BOOLEAN DEFAULT 0, "	\
+		"keyid TEXT);"							\
+	"CREATE INDEX autocrypt_keyid ON autocrypt(keyid);" \
+	"PRAGMA user_version = 1;"
 
+#define DB_MIGRATE_1							\
+	"BEGIN;"									\
+	"ALTER TABLE autocrypt ADD COLUMN keyid TEXT;" \
+	"UPDATE autocrypt SET fingerprint = UPPER(fingerprint), keyid = SUBSTR(UPPER(fingerprint), -16);" \
+	"CREATE INDEX autocrypt_keyid ON autocrypt(keyid);" \
+	"PRAGMA user_version = 1;"					\
+	"COMMIT;"
 
-#define NUM_QUERIES								8U
+
+#define NUM_QUERIES								7U
+
+/* maximum number of addresses in a single "addr IN (...)" query */
+#define MAX_IN_ADDRESSES						250U
 
 
 struct _AutocryptData {
@@ -102,7 +119,9 @@ typedef struct {
 
 
 static void autocrypt_close(void);
+static int autocrypt_db_migrate(void);
 static gboolean extract_ac_keydata(GMimeAutocryptHeader  *autocrypt_header,
+								   const AutocryptData   *db_info,
 								   ac_key_data_t         *dest);
 static void add_or_update_user_info(GMimeAutocryptHeader    *autocrypt_header,
 									const ac_key_data_t     *ac_key_data,
@@ -113,6 +132,23 @@ static void update_last_seen(GMimeAutocryptHeader  *autocrypt_header,
 static AutocryptData *autocrypt_user_info(const gchar  *mailbox,
 										  GError      **error)
 	G_GNUC_WARN_UNUSED_RESULT;
+static GHashTable *autocrypt_users_info(GPtrArray  *mailboxes,
+										GError    **error)
+	G_GNUC_WARN_UNUSED_RESULT;
+static AutocryptData *autocrypt_data_from_row(sqlite3_stmt *stmt)
+	G_GNUC_WARN_UNUSED_RESULT;
+static int prepare_addr_query(const gchar   *select,
+							  const gchar   *condition,
+							  GPtrArray     *mailboxes,
+							  guint          start,
+							  guint          count,
+							  sqlite3_stmt **stmt);
+static void collect_mailboxes(InternetAddressList *addresses,
+							  GPtrArray           *mailboxes);
+static GHashTable *list_key_ids(gpgme_ctx_t   gpgme_ctx,
+								GPtrArray    *patterns,
+								GError      **error)
+	G_GNUC_WARN_UNUSED_RESULT;
 static void autocrypt_free(AutocryptData *data);
 static AutocryptRecommend autocrypt_check_ia_list(gpgme_ctx_t           gpgme_ctx,
 												  InternetAddressList  *recipients,
@@ -140,7 +176,7 @@ static gint get_keys_real(gpgme_ctx_t           gpgme_ctx,
 
 
 static sqlite3 *autocrypt_db = NULL;
-static sqlite3_stmt *query[NUM_QUERIES] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+static sqlite3_stmt *query[NUM_QUERIES] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL };
 G_LOCK_DEFINE_STATIC(db_mutex);
 
 
@@ -150,14 +186,13 @@ autocrypt_init(GError **error)
 {
 	static const gchar * const prepare_statements[NUM_QUERIES] = {
 		"SELECT * FROM autocrypt WHERE addr = LOWER(?)",
-		"INSERT INTO autocrypt VALUES (LOWER(?1), ?2, ?2, ?3, ?4, ?5, ?6)",
-		"UPDATE autocrypt SET last_seen = MAX(?2, last_seen), ac_timestamp = ?2, pubkey = ?3, fingerprint = ?4,"
-		" expires = ?5, prefer_encrypt = ?6 WHERE addr = LOWER(?1)",
+		"INSERT INTO autocrypt VALUES (LOWER(?1), ?2, ?2, ?3, UPPER(?4), ?5, ?6, SUBSTR(UPPER(?4), -16))",
+		"UPDATE autocrypt SET last_seen = MAX(?2, last_seen), ac_timestamp = ?2, pubkey = ?3, fingerprint = UPPER(?4),"
+		" expires = ?5, prefer_encrypt = ?6, keyid = SUBSTR(UPPER(?4), -16) WHERE addr = LOWER(?1)",
 		"UPDATE autocrypt SET last_seen = ?2 WHERE addr = LOWER(?1) AND last_seen < ?2 AND ac_timestamp < ?2",
-		"SELECT pubkey FROM autocrypt WHERE fingerprint LIKE ?",
+		"SELECT pubkey FROM autocrypt WHERE keyid = SUBSTR(?1, -16) AND fingerprint LIKE '%' || ?1",
 		"SELECT addr, last_seen, ac_timestamp, prefer_encrypt, pubkey FROM autocrypt ORDER BY addr ASC",
-		"DELETE FROM autocrypt WHERE addr = LOWER(?1)",
-		"SELECT pubkey FROM autocrypt WHERE addr = LOWER(?1) AND (expires = 0 OR expires > ?2)"
+		"DELETE FROM autocrypt WHERE addr = LOWER(?1)"
 	};
 	gboolean result;
 
@@ -174,9 +209,11 @@ autocrypt_init(GError **error)
 		if (sqlite_res == SQLITE_OK) {
 			guint n;
 
-			/* write the schema if the database is new */
+			/* write the schema if the database is new, update it otherwise */
 			if (require_init) {
 				sqlite_res = sqlite3_exec(autocrypt_db, DB_SCHEMA, NULL, NULL, NULL);
+			} else {
+				sqlite_res = autocrypt_db_migrate();
 			}
 
 			/* always vacuum the database */
@@ -219,6 +256,7 @@ autocrypt_from_message(LibBalsaMessage  *message,
 {
 	LibBalsaMessageHeaders *headers;
 	ac_key_data_t ac_key_data;
+	AutocryptData *db_info;
 	time_t ac_header_time;
 
 	g_return_if_fail(LIBBALSA_IS_MESSAGE(message));
@@ -253,10 +291,8 @@ autocrypt_from_message(LibBalsaMessage  *message,
 
     /* update the database */
     G_LOCK(db_mutex);
-    if (extract_ac_keydata(headers->autocrypt_hdr, &ac_key_data)) {
-    	AutocryptData *db_info;
-
-    	db_info = autocrypt_user_info(g_mime_autocrypt_header_get_address_as_string(headers->autocrypt_hdr), error);
+    db_info = autocrypt_user_info(g_mime_autocrypt_header_get_address_as_string(headers->autocrypt_hdr), error);
+    if (extract_ac_keydata(headers->autocrypt_hdr, db_info, &ac_key_data)) {
     	if (db_info != NULL) {
     		if (ac_header_time > db_info->ac_timestamp) {
     			add_or_update_user_info(headers->autocrypt_hdr, &ac_key_data, TRUE, error);
@@ -264,7 +300,6 @@ autocrypt_from_message(LibBalsaMessage  *message,
     			g_info("message timestamp %ld not newer than autocrypt db timestamp %ld, ignore message",
     				(long) headers->date, (long) db_info->ac_timestamp);
     		}
-    		autocrypt_free(db_info);
     	} else {
     		add_or_update_user_info(headers->autocrypt_hdr, &ac_key_data, FALSE, error);
     	}
@@ -275,6 +310,7 @@ autocrypt_from_message(LibBalsaMessage  *message,
     	 * these two cases. */
         update_last_seen(headers->autocrypt_hdr, error);
     }
+    autocrypt_free(db_info);
     G_UNLOCK(db_mutex);
 }
 
@@ -376,8 +412,8 @@ autocrypt_get_key(const gchar *fingerprint, GError **error)
 
 	g_return_val_if_fail(fingerprint != NULL, NULL);
 
-	/* prepend SQL "LIKE" wildcard */
-	param = g_strconcat("%", fingerprint, NULL);
+	/* the database stores upper-case fingerprints */
+	param = g_ascii_strup(fingerprint, -1);
 
 	G_LOCK(db_mutex);
 	sqlite_res = sqlite3_bind_text(query[4], 1, param, -1, SQLITE_STATIC);
@@ -457,6 +493,86 @@ autocrypt_recommendation(InternetAddressList *recipients, GList **missing_keys,
 }
 
 
+typedef struct {
+	InternetAddressList *recipients;
+	GList *missing_keys;
+} recommend_data_t;
+
+static void
+recommend_data_free(recommend_data_t *data)
+{
+	g_object_unref(data->recipients);
+	g_list_free_full(data->missing_keys, (GDestroyNotify) g_bytes_unref);
+	g_free(data);
+}
+
+static void
+autocrypt_recommendation_thread(GTask        *task,
+								gpointer      source_object,
+								gpointer      task_data,
+								GCancellable *cancellable)
+{
+	recommend_data_t *data = (recommend_data_t *) task_data;
+	AutocryptRecommend result;
+	GError *error = NULL;
+
+	result = autocrypt_recommendation(data->recipients, &data->missing_keys, &error);
+	if (result == AUTOCRYPT_ENCR_ERROR) {
+		if (error == NULL) {
+			g_set_error(&error, AUTOCRYPT_ERROR_QUARK, -1, _("unknown"));
+		}
+		g_task_return_error(task, error);
+	} else {
+		g_task_return_int(task, result);
+	}
+}
+
+
+/* documentation: see header file */
+void
+autocrypt_recommendation_async(InternetAddressList *recipients,
+							   GCancellable        *cancellable,
+							   GAsyncReadyCallback  callback,
+							   gpointer             user_data)
+{
+	GTask *task;
+	recommend_data_t *data;
+
+	g_return_if_fail(IS_INTERNET_ADDRESS_LIST(recipients));
+
+	data = g_new0(recommend_data_t, 1U);
+	data->recipients = g_object_ref(recipients);
+	task = g_task_new(NULL, cancellable, callback, user_data);
+	g_task_set_task_data(task, data, (GDestroyNotify) recommend_data_free);
+	g_task_run_in_thread(task, autocrypt_recommendation_thread);
+	g_object_unref(task);
+}
+
+
+/* documentation: see header file */
+AutocryptRecommend
+autocrypt_recommendation_finish(GAsyncResult  *result,
+								GList        **missing_keys,
+								GError       **error)
+{
+	GTask *task = G_TASK(result);
+	gssize mode;
+
+	mode = g_task_propagate_int(task, error);
+	if (mode < 0) {
+		return AUTOCRYPT_ENCR_ERROR;
+	}
+
+	if (missing_keys != NULL) {
+		recommend_data_t *data = (recommend_data_t *) g_task_get_task_data(task);
+
+		*missing_keys = data->missing_keys;
+		data->missing_keys = NULL;
+	}
+	return (AutocryptRecommend) mode;
+}
+
+
 static void
 autocrypt_db_dialog_run_response(GtkDialog *self,
                                  gint       response,
@@ -599,67 +715,149 @@ autocrypt_check_ia_list(gpgme_ctx_t           gpgme_ctx,
 						GError              **error)
 {
 	AutocryptRecommend result = AUTOCRYPT_ENCR_AVAIL_MUTUAL;
-	gint i;
+	GPtrArray *mailboxes;
+	GHashTable *db_users;
+	GHashTable *key_ids = NULL;
+	guint n;
 
-	for (i = 0; (result > AUTOCRYPT_ENCR_DISABLE) && (i < internet_address_list_length(recipients)); i++) {
-    	InternetAddress *ia = internet_address_list_get_address(recipients, i);
+	/* look up all recipients, including group members, in the Autocrypt database at once */
+	mailboxes = g_ptr_array_new_with_free_func(g_free);
+	collect_mailboxes(recipients, mailboxes);
+	G_LOCK(db_mutex);
+	db_users = autocrypt_users_info(mailboxes, error);
+	G_UNLOCK(db_mutex);
 
-    	/* check all entries in the list, handle groups recursively */
-    	if (INTERNET_ADDRESS_IS_GROUP(ia)) {
-    		result = autocrypt_check_ia_list(gpgme_ctx, INTERNET_ADDRESS_GROUP(ia)->members, ref_time, missing_keys, error);
-    	} else {
-    		AutocryptData *autocrypt_user;
-    		const gchar *mailbox;
-
-    		mailbox = INTERNET_ADDRESS_MAILBOX(ia)->addr;
-    		G_LOCK(db_mutex);
-    		autocrypt_user = autocrypt_user_info(mailbox, NULL);
-    		G_UNLOCK(db_mutex);
-    		if (autocrypt_user == NULL) {
-        		GList *keys = NULL;
-
-    			/* check if we have a public key, keep the state if we found one, disable if not */
-        		if (libbalsa_gpgme_list_keys(gpgme_ctx, &keys, NULL, mailbox, FALSE, FALSE, error)) {
-        			if (keys != NULL) {
-        				g_list_free_full(keys, (GDestroyNotify) gpgme_key_unref);
-        				g_debug("'%s': found in public key ring, overall status %d", mailbox, result);
-        			} else {
-        				result = AUTOCRYPT_ENCR_DISABLE;
-        				g_debug("'%s': not in Autocrypt db or public key ring, overall status %d", mailbox, result);
-        			}
-        		} else {
-        			result = AUTOCRYPT_ENCR_ERROR;
-        		}
-    		} else {
-    			/* we found Autocrypt data for this user */
-    			if ((autocrypt_user->expires > 0) && (autocrypt_user->expires <= ref_time)) {
-    				result = AUTOCRYPT_ENCR_DISABLE;		/* key has expired */
-    			} else if (autocrypt_user->ac_timestamp < (autocrypt_user->last_seen - (35 * 24 * 60 * 60))) {
-    				result = MIN(result, AUTOCRYPT_ENCR_DISCOURAGE);	/* Autocrypt timestamp > 35 days older than last seen */
-    			} else if (autocrypt_user->prefer_encrypt) {
-    				result = MIN(result, AUTOCRYPT_ENCR_AVAIL_MUTUAL);	/* user requested "prefer-encrypt=mutual" */
-    			} else {
-    				result = MIN(result, AUTOCRYPT_ENCR_AVAIL);			/* user did not request "prefer-encrypt=mutual" */
-    			}
-
-    			/* check if the Autocrypt key is already in the key ring, add it to the list of missing ones otherwise */
-    			if (missing_keys != NULL) {
-            		GList *keys = NULL;
-
-            		if (libbalsa_gpgme_list_keys(gpgme_ctx, &keys, NULL, autocrypt_user->fingerprint, FALSE, FALSE, error)) {
-            			if (keys != NULL) {
-            				g_list_free_full(keys, (GDestroyNotify) gpgme_key_unref);
-            			} else {
-            				*missing_keys = g_list_prepend(*missing_keys, g_bytes_ref(autocrypt_user->keydata));
-            			}
-            		} else {
-            			result = AUTOCRYPT_ENCR_ERROR;
-            		}
-    			}
-    			autocrypt_free(autocrypt_user);
-    			g_debug("'%s': found in Autocrypt db, overall status %d", mailbox, result);
-    		}
-    	}
+	/* list all keys we need in a single operation: the public keys of recipients which are not in the Autocrypt database, and
+	 * the Autocrypt keys which might be missing in the key ring */
+	if (db_users != NULL) {
+		GPtrArray *patterns;
+
+		patterns = g_ptr_array_new_with_free_func(g_free);
+		for (n = 0U; n < mailboxes->len; n++) {
+			const gchar *mailbox = g_ptr_array_index(mailboxes, n);
+			AutocryptData *autocrypt_user;
+
+			autocrypt_user = g_hash_table_lookup(db_users, mailbox);
+			if (autocrypt_user == NULL) {
+				g_ptr_array_add(patterns, g_strconcat("<", mailbox, ">", NULL));
+			} else if (missing_keys != NULL) {
+				g_ptr_array_add(patterns, g_strdup(autocrypt_user->fingerprint));
+			}
+		}
+		key_ids = list_key_ids(gpgme_ctx, patterns, error);
+		g_ptr_array_unref(patterns);
+	}
+	if (key_ids == NULL) {
+		result = AUTOCRYPT_ENCR_ERROR;
+	}
+
+	for (n = 0U; (result > AUTOCRYPT_ENCR_DISABLE) && (n < mailboxes->len); n++) {
+		const gchar *mailbox = g_ptr_array_index(mailboxes, n);
+		AutocryptData *autocrypt_user;
+
+		autocrypt_user = g_hash_table_lookup(db_users, mailbox);
+		if (autocrypt_user == NULL) {
+			/* check if we have a public key, keep the state if we found one, disable if not */
+			if (g_hash_table_contains(key_ids, mailbox)) {
+				g_debug("'%s': found in public key ring, overall status %d", mailbox, result);
+			} else {
+				result = AUTOCRYPT_ENCR_DISABLE;
+				g_debug("'%s': not in Autocrypt db or public key ring, overall status %d", mailbox, result);
+			}
+		} else {
+			/* we found Autocrypt data for this user */
+			if ((autocrypt_user->expires > 0) && (autocrypt_user->expires <= ref_time)) {
+				result = AUTOCRYPT_ENCR_DISABLE;		/* key has expired */
+			} else if (autocrypt_user->ac_timestamp < (autocrypt_user->last_seen - (35 * 24 * 60 * 60))) {
+				result = MIN(result, AUTOCRYPT_ENCR_DISCOURAGE);	/* Autocrypt timestamp > 35 days older than last seen */
+			} else if (autocrypt_user->prefer_encrypt) {
+				result = MIN(result, AUTOCRYPT_ENCR_AVAIL_MUTUAL);	/* user requested "prefer-encrypt=mutual" */
+			} else {
+				result = MIN(result, AUTOCRYPT_ENCR_AVAIL);			/* user did not request "prefer-encrypt=mutual" */
+			}
+
+			/* check if the Autocrypt key is already in the key ring, add it to the list of missing ones otherwise */
+			if ((missing_keys != NULL) && !g_hash_table_contains(key_ids, autocrypt_user->fingerprint)) {
+				*missing_keys = g_list_prepend(*missing_keys, g_bytes_ref(autocrypt_user->keydata));
+			}
+			g_debug("'%s': found in Autocrypt db, overall status %d", mailbox, result);
+		}
+	}
+
+	if (key_ids != NULL) {
+		g_hash_table_destroy(key_ids);
+	}
+	if (db_users != NULL) {
+		g_hash_table_destroy(db_users);
+	}
+	g_ptr_array_unref(mailboxes);
+
+	return result;
+}
+
+
+/* collect the lower-case mailbox addresses from an internet address list, including the members of groups */
+static void
+collect_mailboxes(InternetAddressList *addresses, GPtrArray *mailboxes)
+{
+	gint n;
+
+	for (n = 0; n < internet_address_list_length(addresses); n++) {
+		InternetAddress *ia = internet_address_list_get_address(addresses, n);
+
+		if (INTERNET_ADDRESS_IS_GROUP(ia)) {
+			collect_mailboxes(INTERNET_ADDRESS_GROUP(ia)->members, mailboxes);
+		} else {
+			g_ptr_array_add(mailboxes, g_ascii_strdown(INTERNET_ADDRESS_MAILBOX(ia)->addr, -1));
+		}
+	}
+}
+
+
+/** \brief List the identifiers of the keys matching any of the passed patterns
+ *
+ * \param gpgme_ctx GpgME context
+ * \param patterns array of key search patterns, may be empty
+ * \param error filled with error information on error, may be NULL
+ * \return a hash table containing the lower-case mailboxes of the user IDs and the fingerprints of all subkeys of all valid
+ *         matching public keys, or NULL on error
+ *
+ * All patterns are searched in a single key list operation, instead of one operation (and gpg run) per pattern.
+ */
+static GHashTable *
+list_key_ids(gpgme_ctx_t gpgme_ctx, GPtrArray *patterns, GError **error)
+{
+	GHashTable *result;
+	GList *keys = NULL;
+
+	result = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	if (patterns->len > 0U) {
+		g_ptr_array_add(patterns, NULL);
+		if (libbalsa_gpgme_list_keys_ext(gpgme_ctx, &keys, (const gchar **) patterns->pdata, FALSE, error)) {
+			GList *p;
+
+			for (p = keys; p != NULL; p = p->next) {
+				gpgme_key_t key = (gpgme_key_t) p->data;
+				gpgme_user_id_t uid;
+				gpgme_subkey_t subkey;
+
+				for (uid = key->uids; uid != NULL; uid = uid->next) {
+					if (uid->email != NULL) {
+						g_hash_table_add(result, g_ascii_strdown(uid->email, -1));
+					}
+				}
+				for (subkey = key->subkeys; subkey != NULL; subkey = subkey->next) {
+					if (subkey->fpr != NULL) {
+						g_hash_table_add(result, g_ascii_strup(subkey->fpr, -1));
+					}
+				}
+			}
+			g_list_free_full(keys, (GDestroyNotify) gpgme_key_unref);
+		} else {
+			g_hash_table_destroy(result);
+			result = NULL;
+		}
+		g_ptr_array_remove_index(patterns, patterns->len - 1U);
 	}
 
 	return result;
@@ -697,6 +895,31 @@ autocrypt_close(void)
 }
 
 
+/* note: this function is called when db_mutex is already locked, so DO NOT lock it again */
+static int
+autocrypt_db_migrate(void)
+{
+	sqlite3_stmt *stmt;
+	int sqlite_res;
+	gint version = 0;
+
+	sqlite_res = sqlite3_prepare_v2(autocrypt_db, "PRAGMA user_version", -1, &stmt, NULL);
+	if (sqlite_res == SQLITE_OK) {
+		if (sqlite3_step(stmt) == SQLITE_ROW) {
+			version = sqlite3_column_int(stmt, 0);
+		}
+		sqlite3_finalize(stmt);
+	}
+
+	if ((sqlite_res == SQLITE_OK) && (version < DB_SCHEMA_VERSION)) {
+		g_debug("update Autocrypt database schema from version %d to %d", version, DB_SCHEMA_VERSION);
+		sqlite_res = sqlite3_exec(autocrypt_db, DB_MIGRATE_1, NULL, NULL, NULL);
+	}
+
+	return sqlite_res;
+}
+
+
 /* note: this function is called when db_mutex is already locked, so DO NOT lock it again */
 static AutocryptData *
 autocrypt_user_info(const gchar *mailbox, GError **error)
@@ -710,14 +933,7 @@ autocrypt_user_info(const gchar *mailbox, GError **error)
 	if (sqlite_res == SQLITE_OK) {
 		sqlite_res = sqlite3_step(query[0]);
 		if (sqlite_res == SQLITE_ROW) {
-			user_info = g_new0(AutocryptData, 1U);
-			user_info->addr = g_strdup((const gchar *) sqlite3_column_text(query[0], 0));
-			user_info->last_seen = sqlite3_column_int64(query[0], 1);
-			user_info->ac_timestamp = sqlite3_column_int64(query[0], 2);
-			user_info->keydata = g_bytes_new(sqlite3_column_blob(query[0], 3), sqlite3_column_bytes(query[0], 3));
-			user_info->fingerprint = g_strdup((const gchar *) sqlite3_column_text(query[0], 4));
-			user_info->expires = sqlite3_column_int64(query[0], 5);
-			user_info->prefer_encrypt = (sqlite3_column_int(query[0], 6) != 0);
+			user_info = autocrypt_data_from_row(query[0]);
 			sqlite_res = sqlite3_step(query[0]);
 		}
 
@@ -739,14 +955,112 @@ autocrypt_user_info(const gchar *mailbox, GError **error)
 }
 
 
+/* note: this function is called when db_mutex is already locked, so DO NOT lock it again
+ * returns a hash table mapping the passed lower-case mailboxes to their AutocryptData, omitting those which are not in the
+ * database, or NULL on error */
+static GHashTable *
+autocrypt_users_info(GPtrArray *mailboxes, GError **error)
+{
+	GHashTable *users;
+	guint start;
+	int sqlite_res = SQLITE_OK;
+
+	g_return_val_if_fail(autocrypt_db != NULL, NULL);
+
+	users = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify) autocrypt_free);
+	for (start = 0U; (sqlite_res == SQLITE_OK) && (start < mailboxes->len); start += MAX_IN_ADDRESSES) {
+		sqlite3_stmt *stmt = NULL;
+
+		sqlite_res = prepare_addr_query("SELECT *", "", mailboxes, start, MIN(mailboxes->len - start, MAX_IN_ADDRESSES), &stmt);
+		if (sqlite_res == SQLITE_OK) {
+			while ((sqlite_res = sqlite3_step(stmt)) == SQLITE_ROW) {
+				AutocryptData *user_info;
+
+				user_info = autocrypt_data_from_row(stmt);
+				g_hash_table_replace(users, user_info->addr, user_info);
+			}
+			if (sqlite_res == SQLITE_DONE) {
+				sqlite_res = SQLITE_OK;
+			}
+		}
+		sqlite3_finalize(stmt);
+	}
+
+	if (sqlite_res != SQLITE_OK) {
+		/* Translators: #1 error message */
+		g_set_error(error, AUTOCRYPT_ERROR_QUARK, sqlite_res, _("error reading Autocrypt data: %s"), sqlite3_errmsg(autocrypt_db));
+		g_hash_table_destroy(users);
+		users = NULL;
+	}
+
+	return users;
+}
+
+
+/* note: this function is called when db_mutex is already locked, so DO NOT lock it again
+ * prepares the statement "<select> FROM autocrypt WHERE addr IN (...)<condition>" for count mailboxes, starting at index start,
+ * and binds them to the parameters 1 to count */
+static int
+prepare_addr_query(const gchar *select, const gchar *condition, GPtrArray *mailboxes, guint start, guint count,
+	sqlite3_stmt **stmt)
+{
+	GString *sql;
+	guint n;
+	int sqlite_res;
+
+	sql = g_string_new(select);
+	g_string_append(sql, " FROM autocrypt WHERE addr IN (?");
+	for (n = 1U; n < count; n++) {
+		g_string_append(sql, ", ?");
+	}
+	g_string_append_c(sql, ')');
+	g_string_append(sql, condition);
+	sqlite_res = sqlite3_prepare_v2(autocrypt_db, sql->str, -1, stmt, NULL);
+	g_string_free(sql, TRUE);
+
+	for (n = 0U; (sqlite_res == SQLITE_OK) && (n < count); n++) {
+		sqlite_res = sqlite3_bind_text(*stmt, n + 1, g_ptr_array_index(mailboxes, start + n), -1, SQLITE_STATIC);
+	}
+
+	return sqlite_res;
+}
+
+
+/* create AutocryptData from the current result row of a "SELECT * FROM autocrypt" statement */
+static AutocryptData *
+autocrypt_data_from_row(sqlite3_stmt *stmt)
+{
+	AutocryptData *user_info;
+
+	user_info = g_new0(AutocryptData, 1U);
+	user_info->addr = g_strdup((const gchar *) sqlite3_column_text(stmt, 0));
+	user_info->last_seen = sqlite3_column_int64(stmt, 1);
+	user_info->ac_timestamp = sqlite3_column_int64(stmt, 2);
+	user_info->keydata = g_bytes_new(sqlite3_column_blob(stmt, 3), sqlite3_column_bytes(stmt, 3));
+	user_info->fingerprint = g_strdup((const gchar *) sqlite3_column_text(stmt, 4));
+	user_info->expires = sqlite3_column_int64(stmt, 5);
+	user_info->prefer_encrypt = (sqlite3_column_int(stmt, 6) != 0);
+
+	return user_info;
+}
+
+
+/* note: if the key data is identical to the one already stored in the database (db_info, may be NULL), its fingerprint and expiry
+ * date are re-used, which avoids spawning gpg for a temporary context for every message from the same sender */
 static gboolean
-extract_ac_keydata(GMimeAutocryptHeader *autocrypt_header, ac_key_data_t *dest)
+extract_ac_keydata(GMimeAutocryptHeader *autocrypt_header, const AutocryptData *db_info, ac_key_data_t *dest)
 {
 	GBytes *keydata;
 	gboolean success = FALSE;
 
 	keydata = g_mime_autocrypt_header_get_keydata(autocrypt_header);
-	if (keydata != NULL) {
+	if ((keydata != NULL) && (db_info != NULL) && g_bytes_equal(keydata, db_info->keydata)) {
+		dest->keydata = g_bytes_get_data(keydata, &dest->keysize);
+		dest->fingerprint = g_strdup(db_info->fingerprint);
+		dest->expires = db_info->expires;
+		g_debug("key for '%s' unchanged", db_info->addr);
+		success = TRUE;
+	} else if (keydata != NULL) {
 		gpgme_ctx_t ctx;
 		gchar *temp_dir = NULL;
 
@@ -1113,64 +1427,71 @@ remove_key_cb(GtkMenuItem G_GNUC_UNUSED *menuitem, gpointer user_data)
 static gint
 get_keys_real(gpgme_ctx_t gpgme_ctx, InternetAddressList *addresses, time_t now, GError **error)
 {
-	gint n;
+	GPtrArray *mailboxes;
+	GPtrArray *patterns;
+	GPtrArray *missing;
+	GHashTable *key_ids;
+	guint n;
 	gint imported = 0;
 
-	for (n = 0; (imported >= 0) && (n < internet_address_list_length(addresses)); n++) {
-		InternetAddress *this_addr;
+	/* check which mailboxes have a public key in a single key list operation */
+	mailboxes = g_ptr_array_new_with_free_func(g_free);
+	collect_mailboxes(addresses, mailboxes);
+	patterns = g_ptr_array_new_with_free_func(g_free);
+	for (n = 0U; n < mailboxes->len; n++) {
+		g_ptr_array_add(patterns, g_strconcat("<", (const gchar *) g_ptr_array_index(mailboxes, n), ">", NULL));
+	}
+	key_ids = list_key_ids(gpgme_ctx, patterns, error);
+	g_ptr_array_unref(patterns);
+	if (key_ids == NULL) {
+		g_ptr_array_unref(mailboxes);
+		return -1;
+	}
+
+	missing = g_ptr_array_new();
+	for (n = 0U; n < mailboxes->len; n++) {
+		if (!g_hash_table_contains(key_ids, g_ptr_array_index(mailboxes, n))) {
+			g_ptr_array_add(missing, g_ptr_array_index(mailboxes, n));
+		}
+	}
+	g_hash_table_destroy(key_ids);
 
-		this_addr = internet_address_list_get_address(addresses, n);
-		if (INTERNET_ADDRESS_IS_MAILBOX(this_addr)) {
-			if (!libbalsa_gpgme_have_key(gpgme_ctx, INTERNET_ADDRESS_MAILBOX(this_addr), NULL)) {
-				const gchar *mailbox = INTERNET_ADDRESS_MAILBOX(this_addr)->addr;
+	/* import the unexpired Autocrypt keys of all others */
+	G_LOCK(db_mutex);
+	for (n = 0U; (imported >= 0) && (n < missing->len); n += MAX_IN_ADDRESSES) {
+		guint count = MIN(missing->len - n, MAX_IN_ADDRESSES);
+		sqlite3_stmt *stmt = NULL;
+		int sqlite_res;
 
-				G_LOCK(db_mutex);
-				if ((sqlite3_bind_text(query[7], 1, mailbox, -1, SQLITE_STATIC) != SQLITE_OK) ||
-					(sqlite3_bind_int64(query[7], 2, now) != SQLITE_OK)) {
-					/* Translators: #1 email address (mailbox); #2 error message */
-					g_set_error(error, AUTOCRYPT_ERROR_QUARK, -1, _("error reading Autocrypt data for “%s”: %s"), mailbox,
-						sqlite3_errmsg(autocrypt_db));
-					imported = -1;
-				} else {
-					int sqlite_res;
-
-					sqlite_res = sqlite3_step(query[7]);
-					if (sqlite_res == SQLITE_ROW) {
-						GBytes *keybuf;
-
-						keybuf = g_bytes_new_static(sqlite3_column_blob(query[7], 0), sqlite3_column_bytes(query[7], 0));
-						if (libbalsa_gpgme_import_bin_key(gpgme_ctx, keybuf, NULL, error)) {
-							imported++;
-						} else {
-							imported = -1;
-						}
-						g_bytes_unref(keybuf);
-						sqlite_res = sqlite3_step(query[7]);
-					}
+		sqlite_res = prepare_addr_query("SELECT pubkey", " AND (expires = 0 OR expires > ?)", missing, n, count, &stmt);
+		if (sqlite_res == SQLITE_OK) {
+			sqlite_res = sqlite3_bind_int64(stmt, count + 1, now);
+		}
+		if (sqlite_res == SQLITE_OK) {
+			while ((imported >= 0) && ((sqlite_res = sqlite3_step(stmt)) == SQLITE_ROW)) {
+				GBytes *keybuf;
 
-					if (sqlite_res != SQLITE_DONE) {
-						/* Translators: #1 email address (mailbox); #2 error message */
-						g_set_error(error, AUTOCRYPT_ERROR_QUARK, sqlite_res, _("error reading Autocrypt data for “%s”: %s"),
-							mailbox, sqlite3_errmsg(autocrypt_db));
-						imported = -1;
-					}
+				keybuf = g_bytes_new_static(sqlite3_column_blob(stmt, 0), sqlite3_column_bytes(stmt, 0));
+				if (libbalsa_gpgme_import_bin_key(gpgme_ctx, keybuf, NULL, error)) {
+					imported++;
+				} else {
+					imported = -1;
 				}
-				sqlite3_reset(query[7]);
-				G_UNLOCK(db_mutex);
-			}
-		} else if (INTERNET_ADDRESS_IS_GROUP(this_addr)) {
-			gint sub_count;
-
-			sub_count = get_keys_real(gpgme_ctx, INTERNET_ADDRESS_GROUP(this_addr)->members, now, error);
-			if (sub_count >= 0) {
-				imported += sub_count;
-			} else {
-				imported = sub_count;
+				g_bytes_unref(keybuf);
 			}
-		} else {
-			g_assert_not_reached();		/* should never happen */
 		}
+		if ((imported >= 0) && (sqlite_res != SQLITE_DONE)) {
+			/* Translators: #1 error message */
+			g_set_error(error, AUTOCRYPT_ERROR_QUARK, sqlite_res, _("error reading Autocrypt data: %s"),
+				sqlite3_errmsg(autocrypt_db));
+			imported = -1;
+		}
+		sqlite3_finalize(stmt);
 	}
+	G_UNLOCK(db_mutex);
+
+	g_ptr_array_unref(missing);
+	g_ptr_array_unref(mailboxes);
 
 	return imported;
 }
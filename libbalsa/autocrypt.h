@@ -104,7 +104,7 @@ gboolean autocrypt_ignore(GMimeContentType *content_type);
 
 /** \brief Get a key from the Autocrypt database by fingerprint
  *
- * \param fingerprint key fingerprint
+ * \param fingerprint key fingerprint, or its trailing part of at least 16 hex digits (i.e. the key ID)
  * \param error filled with error information on error, may be NULL
  * \return a new object containing the raw key data on success, or NULL if the key is not in the Autocrypt database
  *
@@ -144,6 +144,32 @@ AutocryptRecommend autocrypt_recommendation(InternetAddressList  *recipients,
 											GList 				**missing_keys,
 											GError              **error);
 
+/** \brief Get the recommendation for encryption in a worker thread
+ *
+ * \param recipients message recipients, must not be changed until the callback has been called
+ * \param cancellable cancellable, may be NULL
+ * \param callback called in the main context when the recommendation is available
+ * \param user_data user data passed to the callback
+ *
+ * Asynchronous version of autocrypt_recommendation().  Call autocrypt_recommendation_finish() from the callback to get the
+ * result.
+ */
+void autocrypt_recommendation_async(InternetAddressList *recipients,
+									GCancellable        *cancellable,
+									GAsyncReadyCallback  callback,
+									gpointer             user_data);
+
+/** \brief Finish an asynchronous recommendation check
+ *
+ * \param result the result passed to the callback of autocrypt_recommendation_async()
+ * \param missing_keys filled with a list of GBytes *, containing all Autocrypt keys missing in the key ring, may be NULL
+ * \param error filled with error information on error or if the operation has been cancelled, may be NULL
+ * \return the result of the recommendation check
+ */
+AutocryptRecommend autocrypt_recommendation_finish(GAsyncResult  *result,
+												   GList        **missing_keys,
+												   GError       **error);
+
 /** \brief Show the Autocrypt database
  *
  * \param date_string time stamp formatting template
@@ -94,10 +94,27 @@
  * @strncmp_func: The function to use when comparing strings.  Use
  *                libbalsa_completion_set_compare() to modify this
  *                function.
+ * @word_index: whether the items' strings are indexed by word, see
+ *              libbalsa_completion_set_word_index().
+ * @index: sorted array of #LibBalsaCompletionKey, built on the first
+ *         completion after the items changed.
+ * @index_items: the items in the order they were added; the
+ *               #LibBalsaCompletionKey.item members refer to it.
  *
  * The data structure used for automatic completion.
  **/
 
+/*
+ * The index: one key for each item if strncmp() is used, or one key for
+ * each word of each item if the word index is enabled.  The keys are
+ * sorted with strcmp(), so all keys starting with a prefix form a
+ * contiguous range, which is found by a binary search.
+ */
+typedef struct {
+    const gchar *key;
+    guint        item;
+} LibBalsaCompletionKey;
+
 /**
  * LibBalsaCompletionFunc:
  * @Param1: the completion item.
@@ -144,10 +161,129 @@ libbalsa_completion_new(LibBalsaCompletionFunc func)
     gcomp->prefix = NULL;
     gcomp->func = func;
     gcomp->strncmp_func = strncmp;
+    gcomp->word_index = FALSE;
+    gcomp->index = NULL;
+    gcomp->index_items = NULL;
 
     return gcomp;
 }
 
+/* Drop the index; it is rebuilt on the next completion. */
+static void
+libbalsa_completion_clear_index(LibBalsaCompletion * cmp)
+{
+    if (cmp->index != NULL) {
+        g_array_free(cmp->index, TRUE);
+        cmp->index = NULL;
+    }
+    if (cmp->index_items != NULL) {
+        g_ptr_array_free(cmp->index_items, TRUE);
+        cmp->index_items = NULL;
+    }
+}
+
+static gint
+libbalsa_completion_key_compare(gconstpointer a, gconstpointer b)
+{
+    const LibBalsaCompletionKey *key_a = a;
+    const LibBalsaCompletionKey *key_b = b;
+    gint retval;
+
+    retval = strcmp(key_a->key, key_b->key);
+    if (retval == 0)
+        retval = (key_a->item > key_b->item) - (key_a->item < key_b->item);
+
+    return retval;
+}
+
+static void
+libbalsa_completion_build_index(LibBalsaCompletion * cmp)
+{
+    GList *list;
+    guint n;
+
+    cmp->index_items = g_ptr_array_new();
+    /* cmp->items is in reverse order of adding */
+    for (list = g_list_last(cmp->items); list != NULL; list = list->prev)
+        g_ptr_array_add(cmp->index_items, list->data);
+
+    cmp->index = g_array_sized_new(FALSE, FALSE,
+                                   sizeof(LibBalsaCompletionKey),
+                                   cmp->index_items->len);
+    for (n = 0; n < cmp->index_items->len; n++) {
+        gpointer data = g_ptr_array_index(cmp->index_items, n);
+        LibBalsaCompletionKey key;
+
+        key.key = cmp->func ? cmp->func(data) : (gchar *) data;
+        key.item = n;
+        while (key.key != NULL) {
+            g_array_append_val(cmp->index, key);
+            if (!cmp->word_index)
+                break;
+            if ((key.key = strchr(key.key, ' ')) != NULL)
+                ++key.key;
+        }
+    }
+    g_array_sort(cmp->index, libbalsa_completion_key_compare);
+}
+
+static gint
+libbalsa_completion_uint_compare(gconstpointer a, gconstpointer b)
+{
+    guint uint_a = *(const guint *) a;
+    guint uint_b = *(const guint *) b;
+
+    return (uint_a > uint_b) - (uint_a < uint_b);
+}
+
+/* Find all items matching prefix in O(log n + k) using the index, and
+ * return them in the order they were added. */
+static GList *
+libbalsa_completion_complete_indexed(LibBalsaCompletion * cmp,
+                                     const gchar        * prefix,
+                                     gsize                len)
+{
+    const LibBalsaCompletionKey *keys;
+    GArray *hits;
+    GList *result = NULL;
+    guint lo, hi, n;
+
+    if (cmp->index == NULL)
+        libbalsa_completion_build_index(cmp);
+
+    keys = (const LibBalsaCompletionKey *) cmp->index->data;
+    lo = 0;
+    hi = cmp->index->len;
+    while (lo < hi) {
+        guint mid = lo + (hi - lo) / 2;
+
+        if (strncmp(keys[mid].key, prefix, len) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    hits = g_array_new(FALSE, FALSE, sizeof(guint));
+    for (n = lo;
+         n < cmp->index->len && strncmp(keys[n].key, prefix, len) == 0;
+         n++)
+        g_array_append_val(hits, keys[n].item);
+    g_array_sort(hits, libbalsa_completion_uint_compare);
+
+    /* build the list backwards, skipping items matching several words */
+    for (n = hits->len; n > 0; n--) {
+        guint item = g_array_index(hits, guint, n - 1);
+
+        if (n == hits->len || item != g_array_index(hits, guint, n))
+            result = g_list_prepend(result,
+                                    g_ptr_array_index(cmp->index_items,
+                                                      item));
+    }
+    g_array_free(hits, TRUE);
+
+    return result;
+}
+
 /**
  * libbalsa_completion_add_items:
  * @cmp: the #LibBalsaCompletion.
@@ -174,6 +310,8 @@ libbalsa_completion_add_items(LibBalsaCompletion * cmp,
         cmp->prefix = NULL;
     }
 
+    libbalsa_completion_clear_index(cmp);
+
     it = items;
     while (it) {
         cmp->items = g_list_prepend(cmp->items, it->data);
@@ -198,6 +336,7 @@ libbalsa_completion_clear_items(LibBalsaCompletion * cmp)
     cmp->cache = NULL;
     g_free(cmp->prefix);
     cmp->prefix = NULL;
+    libbalsa_completion_clear_index(cmp);
 }
 
 /**
@@ -223,7 +362,12 @@ libbalsa_completion_complete(LibBalsaCompletion * cmp,
     g_return_val_if_fail(prefix != NULL, NULL);
 
     len = strlen(prefix);
-    if (cmp->prefix && cmp->cache) {
+    if (*prefix && cmp->items
+        && (cmp->word_index || cmp->strncmp_func == strncmp)) {
+        g_list_free(cmp->cache);
+        cmp->cache = libbalsa_completion_complete_indexed(cmp, prefix, len);
+        done = TRUE;
+    } else if (cmp->prefix && cmp->cache) {
         plen = strlen(cmp->prefix);
         if (plen <= len && !cmp->strncmp_func(prefix, cmp->prefix, plen)) {
             /* use the cache */
@@ -268,6 +412,27 @@ libbalsa_completion_complete(LibBalsaCompletion * cmp,
     return *prefix ? cmp->cache : cmp->items;
 }
 
+/**
+ * libbalsa_completion_set_word_index:
+ * @cmp: a #LibBalsaCompletion.
+ * @word_index: whether to index each word of the items' strings.
+ *
+ * Declares that the items' strings consist of words separated by a
+ * single space, and that the comparison function set with
+ * libbalsa_completion_set_compare() matches a prefix if any word
+ * starts with it.  With this, or with the default strncmp() comparison,
+ * completion uses a sorted index instead of scanning all items.
+ **/
+void
+libbalsa_completion_set_word_index(LibBalsaCompletion * cmp,
+                                   gboolean             word_index)
+{
+    g_return_if_fail(cmp != NULL);
+
+    cmp->word_index = word_index;
+    libbalsa_completion_clear_index(cmp);
+}
+
 /**
  * libbalsa_completion_free:
  * @cmp: the #LibBalsaCompletion.
@@ -299,4 +464,5 @@ libbalsa_completion_set_compare(LibBalsaCompletion          * cmp,
     g_return_if_fail(strncmp_func != NULL);
 
     cmp->strncmp_func = strncmp_func;
+    libbalsa_completion_clear_index(cmp);
 }
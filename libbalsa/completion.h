@@ -68,6 +68,10 @@ struct _LibBalsaCompletion {
     gchar                        *prefix;
     GList                        *cache;
     LibBalsaCompletionStrncmpFunc strncmp_func;
+
+    gboolean                      word_index;
+    GArray                       *index;
+    GPtrArray                    *index_items;
 };
 
 LibBalsaCompletion *
@@ -89,6 +93,10 @@ libbalsa_completion_set_compare  (LibBalsaCompletion * cmp,
                                   LibBalsaCompletionStrncmpFunc
                                                        strncmp_func);
 
+void
+libbalsa_completion_set_word_index(LibBalsaCompletion * cmp,
+                                   gboolean             word_index);
+
 void
 libbalsa_completion_free         (LibBalsaCompletion * cmp);
 
@@ -49,9 +49,11 @@ struct _LibBalsaImapServer {
     gboolean offline_mode;
 
     GMutex lock; /* protects the following members */
-    guint used_connections;
+    GCond handle_cond; /* signalled when a connection slot may be free */
+    guint used_connections; /* includes connections being opened */
     GList *used_handles;
     GList *free_handles;
+    gboolean prewarming; /* a spare connection is being opened */
     gboolean persistent_cache; /* if TRUE, messages will be cached in
                                     $HOME and preserved between
                                     sessions. If FALSE, messages will be
@@ -59,6 +61,16 @@ struct _LibBalsaImapServer {
     gboolean has_fetch_bug;
     gboolean use_status; /**< server has fast STATUS command */
     gboolean use_idle;  /**< IDLE will work: no dummy firewall on the way */
+
+    GMutex refresh_lock; /* serialises LIST-STATUS refreshes */
+    GMutex status_lock; /* protects the following members */
+    GHashTable *status_cache; /**< folder path -> unseen count + 1 */
+    GHashTable *status_paths; /**< set of folder paths being checked */
+    gboolean status_paths_changed; /**< a path is not yet listed */
+    gint64 status_stamp;      /**< time of the last LIST-STATUS */
+    ImapMboxHandle *notify_handle; /**< handle with NOTIFY (RFC 5465) */
+    gboolean no_list_status;  /**< server lacks LIST-STATUS (RFC 5819)
+                                * or LIST-EXTENDED; protected by lock */
 };
 
 static void libbalsa_imap_server_finalize(GObject * object);
@@ -72,6 +84,10 @@ static gboolean connection_cleanup(gpointer ptr);
 #define CONNECTION_CLEANUP_NOOP_TIME    (20*60)
 /* We try to avoid too many connections per server */
 #define MAX_CONNECTIONS_PER_SERVER 20
+/* Re-use LIST-STATUS results for 30 seconds, i.e. during one check */
+#define STATUS_CACHE_LIFETIME (30 * G_USEC_PER_SEC)
+/* Wait at most 15 seconds for a busy connection to be released */
+#define HANDLE_WAIT_TIMEOUT (15 * G_USEC_PER_SEC)
 
 static GMutex imap_servers_lock;
 static GHashTable *imap_servers = NULL;
@@ -166,12 +182,19 @@ libbalsa_imap_server_init(LibBalsaImapServer * imap_server)
     libbalsa_server_set_protocol(LIBBALSA_SERVER(imap_server), "imap");
     imap_server->key = NULL;
     g_mutex_init(&imap_server->lock);
+    g_cond_init(&imap_server->handle_cond);
     imap_server->max_connections = MAX_CONNECTIONS_PER_SERVER;
     imap_server->used_connections = 0;
     imap_server->used_handles = NULL;
     imap_server->free_handles = NULL;
     imap_server->persistent_cache = TRUE;
     imap_server->use_idle = TRUE;
+    g_mutex_init(&imap_server->refresh_lock);
+    g_mutex_init(&imap_server->status_lock);
+    imap_server->status_cache =
+        g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    imap_server->status_paths =
+        g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
     imap_server->connection_cleanup_id = 
         g_timeout_add_seconds(CONNECTION_CLEANUP_POLL_PERIOD,
                               connection_cleanup, imap_server);
@@ -195,6 +218,11 @@ libbalsa_imap_server_finalize(GObject * object)
 
     libbalsa_imap_server_force_disconnect(imap_server);
     g_mutex_clear(&imap_server->lock);
+    g_cond_clear(&imap_server->handle_cond);
+    g_hash_table_destroy(imap_server->status_cache);
+    g_hash_table_destroy(imap_server->status_paths);
+    g_mutex_clear(&imap_server->status_lock);
+    g_mutex_clear(&imap_server->refresh_lock);
     g_free(imap_server->key); imap_server->key = NULL;
 
     G_OBJECT_CLASS(libbalsa_imap_server_parent_class)->finalize(object);
@@ -279,9 +307,8 @@ lb_imap_server_cleanup(LibBalsaImapServer * imap_server)
     time_t idle_marker;
     GList *list;
 
-    /* Quit if there is an action going on, eg. an connection is being
-     * opened and the user is asked to confirm the certificate or
-     * provide password, etc. */
+    /* Quit if there is an action going on, eg. another thread is
+     * picking or releasing a handle. */
     if(!g_mutex_trylock(&imap_server->lock))
         return; 
 
@@ -479,6 +506,118 @@ handle_connection_error(int rc, struct handle_info *info,
     lb_imap_server_info_free(info);
 }
 
+/* Wait, with imap_server->lock held, until another thread releases a
+ * handle or gives up a connection slot, or until end_time.  The main
+ * thread never waits, since it may be the one holding the handles.
+ * Returns FALSE if the caller should give up. */
+static gboolean
+lb_imap_server_wait_for_handle(LibBalsaImapServer *imap_server,
+                               gint64 end_time)
+{
+    if (!libbalsa_am_i_subthread() || imap_server->offline_mode)
+        return FALSE;
+
+    return g_cond_wait_until(&imap_server->handle_cond, &imap_server->lock,
+                             end_time);
+}
+
+/* Connect info->handle, if needed, without holding imap_server->lock,
+ * so that a slow server or a password dialog does not block threads
+ * that only need an open connection.  The caller must already have
+ * counted the connection in used_connections; on failure, the slot is
+ * given back and info is freed.  A failed spare connection (@prewarm)
+ * must not clear the password, as servers limiting the connections per
+ * user may just reject the extra login. */
+static gboolean
+lb_imap_server_connect(LibBalsaImapServer *imap_server,
+                       struct handle_info *info, gboolean prewarm,
+                       GError **err)
+{
+    LibBalsaServer *server = LIBBALSA_SERVER(imap_server);
+    ImapResult rc;
+
+    if (!imap_mbox_is_disconnected(info->handle))
+        return TRUE;
+
+    rc = imap_mbox_handle_connect(info->handle,
+                                  libbalsa_server_get_host(server));
+    if (rc == IMAP_SUCCESS)
+        return TRUE;
+
+    if (prewarm)
+        lb_imap_server_info_free(info);
+    else
+        handle_connection_error(rc, info, server, err);
+    g_mutex_lock(&imap_server->lock);
+    imap_server->used_connections--;
+    g_cond_broadcast(&imap_server->handle_cond);
+    g_mutex_unlock(&imap_server->lock);
+
+    return FALSE;
+}
+
+/* Open a spare connection in the background and leave it on the free
+ * list, so that the next request need not wait for the login. */
+static gpointer
+lb_imap_server_prewarm(gpointer data)
+{
+    LibBalsaImapServer *imap_server = data;
+    struct handle_info *info;
+
+    info = lb_imap_server_info_new(LIBBALSA_SERVER(imap_server));
+    if (lb_imap_server_connect(imap_server, info, TRUE, NULL)) {
+        g_mutex_lock(&imap_server->lock);
+        imap_server->used_connections--;
+        if (imap_server->offline_mode) {
+            lb_imap_server_info_free(info);
+        } else {
+            info->last_used = time(NULL);
+            imap_server->free_handles =
+                g_list_append(imap_server->free_handles, info);
+        }
+        g_cond_broadcast(&imap_server->handle_cond);
+        g_mutex_unlock(&imap_server->lock);
+    }
+
+    g_mutex_lock(&imap_server->lock);
+    imap_server->prewarming = FALSE;
+    g_mutex_unlock(&imap_server->lock);
+    g_object_unref(imap_server);
+
+    return NULL;
+}
+
+/* Put a newly connected handle on the used list, and if no free
+ * connection is left, start opening the next one.  Only do that when
+ * the password is known, so that a spare connection never asks the
+ * user for anything. */
+static void
+lb_imap_server_add_used(LibBalsaImapServer *imap_server,
+                        struct handle_info *info)
+{
+    LibBalsaServer *server = LIBBALSA_SERVER(imap_server);
+
+    g_mutex_lock(&imap_server->lock);
+    imap_server->used_handles = g_list_prepend(imap_server->used_handles,
+                                               info);
+
+    /* always leave one connection for actions without user */
+    if (imap_server->free_handles == NULL && !imap_server->prewarming
+        && !imap_server->offline_mode
+        && imap_server->used_connections + 1 < imap_server->max_connections
+        && libbalsa_server_get_password(server) != NULL) {
+        GThread *prewarm_thread;
+
+        imap_server->prewarming = TRUE;
+        imap_server->used_connections++;
+        prewarm_thread =
+            g_thread_new("lb_imap_server_prewarm", lb_imap_server_prewarm,
+                         g_object_ref(imap_server));
+        g_thread_unref(prewarm_thread);
+    }
+    g_mutex_unlock(&imap_server->lock);
+}
+
 /**
  * libbalsa_imap_server_get_handle:
  * @server: A #LibBalsaImapServer
@@ -488,6 +627,8 @@ handle_connection_error(int rc, struct handle_info *info,
  * one.  Handle is apriopriate for all commands that work in AUTHENTICATED
  * state (LIST, SUBSCRIBE, CREATE, APPEND) but it MUST not be used for
  * select -- use libbalsa_imap_server_get_handle_with_user for that purpose. 
+ * When all connections are busy, a subthread waits a while for one to
+ * be released.
  *
  * Return value: a handle to the server, or %NULL when there are no
  * free connections.
@@ -497,58 +638,44 @@ libbalsa_imap_server_get_handle(LibBalsaImapServer *imap_server, GError **err)
 {
     LibBalsaServer *server = LIBBALSA_SERVER(imap_server);
     struct handle_info *info = NULL;
+    gint64 end_time;
 
     if (!imap_server || imap_server->offline_mode)
         return NULL;
 
+    end_time = g_get_monotonic_time() + HANDLE_WAIT_TIMEOUT;
     g_mutex_lock(&imap_server->lock);
-    /* look for free connection */
-    if (imap_server->free_handles) {
-        GList *conn;
-        conn = g_list_find_custom(imap_server->free_handles, NULL,
-                                  by_last_user);
-        if (!conn)
-            conn = g_list_first(imap_server->free_handles);
-        info = (struct handle_info*)conn->data;
-        imap_server->free_handles =
-            g_list_delete_link(imap_server->free_handles, conn);
-    }
-    /* create if used < max connections */
-    if (!info
-        && imap_server->used_connections < imap_server->max_connections) {
-    	g_mutex_unlock(&imap_server->lock);
-        info = lb_imap_server_info_new(server);
-        g_mutex_lock(&imap_server->lock);
-        /* FIXME: after dropping and reacquiring the lock,
-         * (imap_server->used_connections < imap_server->max_connections)
-         * might no longer be true--do we care?
-        if (imap_server->used_connections >= imap_server->max_connections) {
-            lb_imap_server_info_free(info);
-            g_mutex_unlock(&imap_server->lock);
-            return NULL;
-        }
-         */
-    }
-    if (info) {
-        if(imap_mbox_is_disconnected(info->handle)) {
-            ImapResult rc;
-
-            rc=imap_mbox_handle_connect(info->handle, libbalsa_server_get_host(server));
-            if(rc != IMAP_SUCCESS) {
-                handle_connection_error(rc, info, server, err);
-                g_mutex_unlock(&imap_server->lock);
-                return NULL;
-            }
+    do {
+        /* look for free connection */
+        if (imap_server->free_handles) {
+            GList *conn;
+            conn = g_list_find_custom(imap_server->free_handles, NULL,
+                                      by_last_user);
+            if (!conn)
+                conn = g_list_first(imap_server->free_handles);
+            info = (struct handle_info*)conn->data;
+            imap_server->free_handles =
+                g_list_delete_link(imap_server->free_handles, conn);
         }
-        /* add handle to used list */
-        imap_server->used_handles = g_list_prepend(imap_server->used_handles,
-                                                   info);
-        imap_server->used_connections++;
+        /* create if used < max connections */
+        else if (imap_server->used_connections
+                 < imap_server->max_connections)
+            info = lb_imap_server_info_new(server);
+    } while (!info && lb_imap_server_wait_for_handle(imap_server, end_time));
+
+    if (!info) {
+        g_mutex_unlock(&imap_server->lock);
+        return NULL;
     }
+    /* reserve the slot while connecting */
+    imap_server->used_connections++;
     g_mutex_unlock(&imap_server->lock);
 
-    /* cppcheck-suppress nullPointer */
-    return info ? info->handle : NULL;
+    if (!lb_imap_server_connect(imap_server, info, FALSE, err))
+        return NULL;
+    lb_imap_server_add_used(imap_server, info);
+
+    return info->handle;
 }
 
 /**
@@ -560,7 +687,9 @@ libbalsa_imap_server_get_handle(LibBalsaImapServer *imap_server, GError **err)
  * connects.  If there is no password set, the user is asked to supply
  * one.  This function first tries to find a handle last used by
  * @user, then a handle without a user and finally the least recently
- * used. @user is usually a pointer to LibBalsaMailbox.
+ * used. @user is usually a pointer to LibBalsaMailbox.  When all
+ * connections are busy, a subthread waits a while for one to be
+ * released.
  *
  * Return value: a handle to the server, or %NULL when there are no free
  * connections.
@@ -571,53 +700,34 @@ libbalsa_imap_server_get_handle_with_user(LibBalsaImapServer *imap_server,
 {
     LibBalsaServer *server = LIBBALSA_SERVER(imap_server);
     struct handle_info *info = NULL;
+    gint64 end_time;
 
     if (imap_server->offline_mode)
         return NULL;
 
+    end_time = g_get_monotonic_time() + HANDLE_WAIT_TIMEOUT;
     g_mutex_lock(&imap_server->lock);
-    /* look for free reusable connection */
-    if (imap_server->free_handles) {
-        GList *conn=NULL;
-        if (user)
-            conn = g_list_find_custom(imap_server->free_handles, user,
-                                      by_last_user);
-        if (!conn)
-            conn = imap_server->free_handles;
-        if (conn) {
+    do {
+        /* look for free reusable connection */
+        if (imap_server->free_handles) {
+            GList *conn=NULL;
+            if (user)
+                conn = g_list_find_custom(imap_server->free_handles, user,
+                                          by_last_user);
+            if (!conn)
+                conn = imap_server->free_handles;
             info = (struct handle_info*)conn->data;
             imap_server->free_handles =
                 g_list_delete_link(imap_server->free_handles, conn);
         }
-    }
-    /* create if used < max connections;
-     * always leave one connection for actions without user, i.e.
-     * those that do not SELECT any mailbox. */
-    if (!info
-        && imap_server->used_connections < imap_server->max_connections-1) {
-    	g_mutex_unlock(&imap_server->lock);
-        info = lb_imap_server_info_new(server);
-        if (!info)
-            return NULL;
-        g_mutex_lock(&imap_server->lock);
-        /* FIXME: after dropping and reacquiring the lock,
-         * (imap_server->used_connections < imap_server->max_connections)
-         * might no longer be true--do we care?
-        if (imap_server->used_connections >= imap_server->max_connections) {
-            lb_imap_server_info_free(info);
-            g_mutex_unlock(&imap_server->lock);
-            return NULL;
-        }
-         */
-    }
-    /* reuse a free connection */
-    if (!info && imap_server->free_handles) {
-        GList *conn;
-        conn = g_list_first(imap_server->free_handles);
-        info = (struct handle_info*)conn->data;
-        imap_server->free_handles =
-            g_list_delete_link(imap_server->free_handles, conn);
-    }
+        /* create if used < max connections;
+         * always leave one connection for actions without user, i.e.
+         * those that do not SELECT any mailbox. */
+        else if (imap_server->used_connections
+                 < imap_server->max_connections - 1)
+            info = lb_imap_server_info_new(server);
+    } while (!info && lb_imap_server_wait_for_handle(imap_server, end_time));
+
     if(!info) {
         g_set_error(err, LIBBALSA_MAILBOX_ERROR,
                     LIBBALSA_MAILBOX_TOOMANYOPEN_ERROR,
@@ -626,24 +736,15 @@ libbalsa_imap_server_get_handle_with_user(LibBalsaImapServer *imap_server,
         g_mutex_unlock(&imap_server->lock);
         return NULL;
     }
-
-    if (imap_mbox_is_disconnected(info->handle)) {
-        ImapResult rc;
-
-        rc=imap_mbox_handle_connect(info->handle, libbalsa_server_get_host(server));
-        if(rc != IMAP_SUCCESS) {
-            handle_connection_error(rc, info, server, err);
-            g_mutex_unlock(&imap_server->lock);
-            return NULL;
-        }
-    }
-    /* add handle to used list */
-    info->last_user = user;
-    imap_server->used_handles = g_list_prepend(imap_server->used_handles,
-                                               info);
+    /* reserve the slot while connecting */
     imap_server->used_connections++;
     g_mutex_unlock(&imap_server->lock);
 
+    if (!lb_imap_server_connect(imap_server, info, FALSE, err))
+        return NULL;
+    info->last_user = user;
+    lb_imap_server_add_used(imap_server, info);
+
     return info->handle;
 }
 
@@ -679,6 +780,7 @@ void libbalsa_imap_server_release_handle(LibBalsaImapServer *imap_server,
     /* add to free list */
         imap_server->free_handles = g_list_append(imap_server->free_handles,
                                                   info);
+    g_cond_broadcast(&imap_server->handle_cond);
     g_mutex_unlock(&imap_server->lock);
 }
 
@@ -735,6 +837,8 @@ libbalsa_imap_server_force_disconnect(LibBalsaImapServer *imap_server)
                    (GDestroyNotify) lb_imap_server_info_free);
     imap_server->free_handles = NULL;
 
+    /* wake up threads waiting for a handle */
+    g_cond_broadcast(&imap_server->handle_cond);
     g_mutex_unlock(&imap_server->lock);
 }
 
@@ -912,3 +1016,250 @@ libbalsa_imap_server_subscriptions(LibBalsaImapServer  *server,
 
 	return result;
 }
+
+/* Folder status from LIST-STATUS (RFC 5819) and NOTIFY (RFC 5465). */
+static void
+lb_imap_server_status_cb(ImapMboxHandle                 *handle,
+                         const char                     *mbox,
+                         const struct ImapStatusResult  *res,
+                         void                           *arg)
+{
+    LibBalsaImapServer *imap_server = LIBBALSA_IMAP_SERVER(arg);
+    guint n;
+
+    for (n = 0U; (res[n].item != IMSTAT_NONE) && (res[n].item != IMSTAT_UNSEEN); n++) {
+        /* nothing */
+    }
+
+    g_mutex_lock(&imap_server->status_lock);
+    if (res[n].item == IMSTAT_UNSEEN) {
+        g_hash_table_insert(imap_server->status_cache, g_strdup(mbox),
+            GUINT_TO_POINTER(res[n].result + 1U));
+    } else {
+        /* a pushed update without UNSEEN: the cached value is stale */
+        g_hash_table_remove(imap_server->status_cache, mbox);
+    }
+    g_mutex_unlock(&imap_server->status_lock);
+}
+
+static void
+lb_imap_server_notify_handle_gone(gpointer data, GObject *handle)
+{
+    LibBalsaImapServer *imap_server = LIBBALSA_IMAP_SERVER(data);
+
+    g_mutex_lock(&imap_server->status_lock);
+    if (imap_server->notify_handle == (ImapMboxHandle *) handle) {
+        imap_server->notify_handle = NULL;
+    }
+    g_mutex_unlock(&imap_server->status_lock);
+}
+
+/* Stop using @handle for NOTIFY: ask the server to stop pushing status
+ * changes to it, and clear its status callback, so that it no longer
+ * updates the cache. */
+static void
+lb_imap_server_forget_notify_handle(LibBalsaImapServer *imap_server,
+                                    ImapMboxHandle     *handle)
+{
+    g_object_weak_unref(G_OBJECT(handle), lb_imap_server_notify_handle_gone, imap_server);
+    lb_imap_server_notify_handle_gone(imap_server, G_OBJECT(handle));
+    imap_mbox_notify_status(handle, NULL, NULL, NULL);
+}
+
+/* Move @handle from the free to the used handles.  Returns FALSE if it
+ * is in use. */
+static gboolean
+lb_imap_server_take_handle(LibBalsaImapServer *imap_server,
+                           ImapMboxHandle     *handle)
+{
+    GList *conn;
+
+    g_mutex_lock(&imap_server->lock);
+    conn = g_list_find_custom(imap_server->free_handles, handle, by_handle);
+    if (conn != NULL) {
+        struct handle_info *info = (struct handle_info *) conn->data;
+
+        imap_server->free_handles = g_list_delete_link(imap_server->free_handles, conn);
+        imap_server->used_handles = g_list_prepend(imap_server->used_handles, info);
+        imap_server->used_connections++;
+    }
+    g_mutex_unlock(&imap_server->lock);
+
+    return conn != NULL;
+}
+
+/* Read the STATUS responses the server pushed to the NOTIFY handle.  If
+ * the handle is in use, its user reads them anyway.  Returns FALSE if
+ * there is no working NOTIFY handle. */
+static gboolean
+lb_imap_server_drain_notify(LibBalsaImapServer *imap_server)
+{
+    ImapMboxHandle *handle;
+    gboolean result;
+
+    g_mutex_lock(&imap_server->status_lock);
+    handle = imap_server->notify_handle;
+    g_mutex_unlock(&imap_server->status_lock);
+    if (handle == NULL) {
+        return FALSE;
+    }
+
+    if (!lb_imap_server_take_handle(imap_server, handle)) {
+        return TRUE;
+    }
+
+    result = imap_mbox_handle_noop(handle) == IMR_OK;
+    if (!result) {
+        lb_imap_server_forget_notify_handle(imap_server, handle);
+    }
+    libbalsa_imap_server_release_handle(imap_server, handle);
+    return result;
+}
+
+/* Fetch the status of all checked folders with one LIST-STATUS command,
+ * and ask the server to push further changes if it supports NOTIFY.  The
+ * NOTIFY handle is preferred, so its set of folders can be updated. */
+static void
+lb_imap_server_refresh_status(LibBalsaImapServer *imap_server)
+{
+    ImapMboxHandle *handle;
+    ImapMboxHandle *notify_handle;
+    gchar **paths;
+
+    g_mutex_lock(&imap_server->status_lock);
+    notify_handle = imap_server->notify_handle;
+    if (notify_handle != NULL) {
+        g_object_ref(notify_handle);
+    }
+    g_mutex_unlock(&imap_server->status_lock);
+
+    if ((notify_handle != NULL) && lb_imap_server_take_handle(imap_server, notify_handle)) {
+        handle = notify_handle;
+    } else {
+        handle = libbalsa_imap_server_get_handle(imap_server, NULL);
+        if (handle == NULL) {
+            g_clear_object(&notify_handle);
+            return;
+        }
+    }
+
+    g_mutex_lock(&imap_server->status_lock);
+    g_hash_table_remove_all(imap_server->status_cache);
+    paths = (gchar **) g_hash_table_get_keys_as_array(imap_server->status_paths, NULL);
+    imap_server->status_paths_changed = FALSE;
+    g_mutex_unlock(&imap_server->status_lock);
+
+    if (imap_mbox_list_status(handle, (const char * const *) paths,
+                              lb_imap_server_status_cb, imap_server) == IMR_OK) {
+        g_mutex_lock(&imap_server->status_lock);
+        imap_server->status_stamp = g_get_monotonic_time();
+        g_mutex_unlock(&imap_server->status_lock);
+        if ((notify_handle != NULL) && (handle != notify_handle)) {
+            /* the NOTIFY handle is busy and cannot be updated: replace it */
+            lb_imap_server_forget_notify_handle(imap_server, notify_handle);
+            g_clear_object(&notify_handle);
+        }
+        if (imap_mbox_notify_status(handle, (const char * const *) paths,
+                                    lb_imap_server_status_cb, imap_server) == IMR_OK) {
+            if (notify_handle == NULL) {
+                g_debug("%s: NOTIFY enabled for %s", __func__,
+                    libbalsa_server_get_host(LIBBALSA_SERVER(imap_server)));
+                g_mutex_lock(&imap_server->status_lock);
+                imap_server->notify_handle = handle;
+                g_mutex_unlock(&imap_server->status_lock);
+                g_object_weak_ref(G_OBJECT(handle), lb_imap_server_notify_handle_gone, imap_server);
+            }
+        } else if (notify_handle != NULL) {
+            /* NOTIFY would not cover the new folders */
+            lb_imap_server_forget_notify_handle(imap_server, handle);
+        }
+    } else if (!imap_mbox_handle_can_do(handle, IMCAP_LIST_STATUS) ||
+               !imap_mbox_handle_can_do(handle, IMCAP_LIST_EXTENDED)) {
+        g_mutex_lock(&imap_server->lock);
+        imap_server->no_list_status = TRUE;
+        g_mutex_unlock(&imap_server->lock);
+    }
+    g_free(paths);
+    libbalsa_imap_server_release_handle(imap_server, handle);
+    g_clear_object(&notify_handle);
+}
+
+/**
+ * libbalsa_imap_server_get_folder_unseen:
+ * @server: A #LibBalsaImapServer
+ * @path: the folder path
+ * @unseen: filled with the number of unseen messages
+ *
+ * Looks up the number of unseen messages in @path using a single
+ * LIST-STATUS command for all folders checked on the server, which is
+ * kept up to date by NOTIFY if the server supports it.  A folder is
+ * included from the next refresh on after it has been asked for the
+ * first time.  Call it only if the server has a fast STATUS command, see
+ * libbalsa_imap_server_get_use_status().
+ *
+ * Return value: %TRUE if @unseen has been filled, %FALSE if the server
+ * does not support LIST-STATUS and LIST-EXTENDED, the folder name
+ * contains a LIST wildcard, or the folder is not listed yet.  In this
+ * case, the caller shall fall back to STATUS.
+ **/
+gboolean
+libbalsa_imap_server_get_folder_unseen(LibBalsaImapServer *imap_server,
+                                       const gchar        *path,
+                                       guint              *unseen)
+{
+    gpointer value;
+    gboolean found;
+    gboolean changed;
+    gboolean no_list_status;
+
+    g_return_val_if_fail(LIBBALSA_IS_IMAP_SERVER(imap_server) && (path != NULL) && (unseen != NULL), FALSE);
+
+    g_mutex_lock(&imap_server->lock);
+    no_list_status = imap_server->no_list_status;
+    g_mutex_unlock(&imap_server->lock);
+
+    /* a name containing a wildcard would list other folders, too */
+    if (no_list_status || imap_server->offline_mode ||
+        (strpbrk(path, "*%") != NULL)) {
+        return FALSE;
+    }
+
+    /* a new folder is checked with STATUS once, and listed from the next
+     * refresh on */
+    g_mutex_lock(&imap_server->status_lock);
+    found = g_hash_table_contains(imap_server->status_paths, path);
+    if (!found) {
+        g_hash_table_add(imap_server->status_paths, g_strdup(path));
+        imap_server->status_paths_changed = TRUE;
+    }
+    g_mutex_unlock(&imap_server->status_lock);
+    if (!found) {
+        return FALSE;
+    }
+
+    g_mutex_lock(&imap_server->refresh_lock);
+    g_mutex_lock(&imap_server->status_lock);
+    changed = imap_server->status_paths_changed;
+    g_mutex_unlock(&imap_server->status_lock);
+    if (changed || !lb_imap_server_drain_notify(imap_server)) {
+        gboolean fresh;
+
+        g_mutex_lock(&imap_server->status_lock);
+        fresh = !changed && (imap_server->status_stamp > 0) &&
+            ((g_get_monotonic_time() - imap_server->status_stamp) < STATUS_CACHE_LIFETIME);
+        g_mutex_unlock(&imap_server->status_lock);
+        if (!fresh) {
+            lb_imap_server_refresh_status(imap_server);
+        }
+    }
+    g_mutex_unlock(&imap_server->refresh_lock);
+
+    g_mutex_lock(&imap_server->status_lock);
+    found = g_hash_table_lookup_extended(imap_server->status_cache, path, NULL, &value);
+    g_mutex_unlock(&imap_server->status_lock);
+    if (found) {
+        *unseen = GPOINTER_TO_UINT(value) - 1U;
+    }
+
+    return found;
+}
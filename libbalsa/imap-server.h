@@ -74,6 +74,9 @@ gboolean libbalsa_imap_server_get_use_status(LibBalsaImapServer *server);
 void libbalsa_imap_server_set_use_idle(LibBalsaImapServer *server,
                                        gboolean use_idle);
 gboolean libbalsa_imap_server_get_use_idle(LibBalsaImapServer *server);
+gboolean libbalsa_imap_server_get_folder_unseen(LibBalsaImapServer *server,
+                                                const gchar        *path,
+                                                guint              *unseen);
 gboolean libbalsa_imap_server_subscriptions(LibBalsaImapServer  *server,
 											GPtrArray			*subscribe,
 											GPtrArray			*unsubscribe,
@@ -371,6 +371,79 @@ imap_mbox_list(ImapMboxHandle *handle, const char* what)
 }
 
 
+/* RFC 5819: LIST-STATUS. Returns the status of the given mailboxes in
+   a single round-trip, using the multiple patterns of LIST-EXTENDED
+   (RFC 5258). The mailbox names are used as patterns, so they must not
+   contain the wildcards '*' or '%'. The STATUS responses are passed to
+   the status callback of the handle. */
+ImapResponse
+imap_mbox_list_status(ImapMboxHandle *handle, const char * const *mailboxes,
+                      ImapStatusCb cb, void *arg)
+{
+  gchar *list, *cmd;
+  ImapResponse rc;
+  ImapStatusCb old_cb;
+  void *old_arg;
+
+  if(!imap_mbox_handle_can_do(handle, IMCAP_LIST_STATUS) ||
+     !imap_mbox_handle_can_do(handle, IMCAP_LIST_EXTENDED))
+    return IMR_NO;
+  g_return_val_if_fail(mailboxes && mailboxes[0], IMR_BAD);
+
+  g_mutex_lock(&handle->mutex);
+  IMAP_REQUIRED_STATE2(handle,IMHS_AUTHENTICATED, IMHS_SELECTED, IMR_BAD);
+  list = imap_mailbox_list_string(mailboxes);
+  cmd = g_strdup_printf("LIST \"\" (%s) "
+                        "RETURN (STATUS (MESSAGES UNSEEN UIDNEXT))", list);
+  old_cb  = handle->status_cb;
+  old_arg = handle->status_arg;
+  handle->status_cb  = cb;
+  handle->status_arg = arg;
+  rc = imap_cmd_exec(handle, cmd);
+  handle->status_cb  = old_cb;
+  handle->status_arg = old_arg;
+  g_free(cmd);
+  g_free(list);
+
+  g_mutex_unlock(&handle->mutex);
+  return rc;
+}
+
+/* RFC 5465: NOTIFY. Ask the server to push STATUS responses for the
+   given mailboxes; they are passed to the status callback of the
+   handle whenever it reads from the server. A new call replaces the
+   previous set of mailboxes. Passing NULL as cb switches
+   notifications off. */
+ImapResponse
+imap_mbox_notify_status(ImapMboxHandle *handle,
+                        const char * const *mailboxes,
+                        ImapStatusCb cb, void *arg)
+{
+  ImapResponse rc;
+
+  if(!imap_mbox_handle_can_do(handle, IMCAP_NOTIFY))
+    return IMR_NO;
+  g_return_val_if_fail(!cb || (mailboxes && mailboxes[0]), IMR_BAD);
+
+  g_mutex_lock(&handle->mutex);
+  IMAP_REQUIRED_STATE2(handle,IMHS_AUTHENTICATED, IMHS_SELECTED, IMR_BAD);
+  handle->status_cb  = cb;
+  handle->status_arg = arg;
+  if(cb) {
+    gchar *list = imap_mailbox_list_string(mailboxes);
+    gchar *cmd = g_strdup_printf("NOTIFY SET STATUS (mailboxes (%s) "
+                                 "(MessageNew MessageExpunge FlagChange))",
+                                 list);
+    rc = imap_cmd_exec(handle, cmd);
+    g_free(cmd);
+    g_free(list);
+  } else
+    rc = imap_cmd_exec(handle, "NOTIFY NONE");
+  g_mutex_unlock(&handle->mutex);
+  return rc;
+}
+
+
 /* 6.3.9 LSUB Command */
 ImapResponse
 imap_mbox_lsub(ImapMboxHandle *handle, const char* what)
@@ -821,13 +894,10 @@ imap_mbox_find_unseen(ImapMboxHandle * h,
     return rc;
 }
 
-/* imap_mbox_handle_msgno_has_flags() this is optimized under
-   assumtion that we need only few flags. The code should probably
-   recognize if too many different flags are needed and in such a case
-   issue a full blown fetch with necessary then renumbering to take
-   care of possible EXPUNGE - which cannot be sent in response to
-   SEARCH.  Additionally, we invert the searching condition for SEEN
-   flag which is most commonly set.
+/* imap_mbox_handle_msgno_has_flags() searches for a single needed
+   flag and fetches all flags when several are needed; see
+   imap_assure_needed_flags().  We invert the searching condition for
+   SEEN flag which is most commonly set.
  */
 
 static void
@@ -842,91 +912,108 @@ set_flag_cache_cb(ImapMboxHandle* h, unsigned seqno, void*arg)
     flags->flag_values |= *searched_flag;
 }
 
-struct flag_needed_data {
-  ImapMboxHandle *handle;
-  ImapMsgFlag     flag;
-};
-static unsigned
-flag_unknown(int i, struct flag_needed_data* d)
+void
+imap_unknown_flag_set_close_range(struct unknown_flag_set *s)
 {
-  ImapFlagCache *f =
-    &g_array_index(d->handle->flag_cache, ImapFlagCache, i-1);
-  return (f->known_flags & d->flag) == d->flag ? 0 : i;
+  if(s->first == 0)
+    return;
+  if(s->seqset->len>0)
+    g_string_append_c(s->seqset, ',');
+  if(s->first == s->last)
+    g_string_append_printf(s->seqset, "%u", s->first);
+  else
+    g_string_append_printf(s->seqset, "%u:%u", s->first, s->last);
+  s->first = 0;
 }
-  
-/* imap_assure_needed_flags issues several SEARCH queries in one shot
-   and hopes the output is not intermixed. This functionl must be
-   called with handle locked. */
+
+/* Messages must be added in ascending order. */
+void
+imap_unknown_flag_set_add(struct unknown_flag_set *s, unsigned seqno)
+{
+  if(s->first != 0 && seqno != s->last + 1)
+    imap_unknown_flag_set_close_range(s);
+  if(s->first == 0)
+    s->first = seqno;
+  s->last = seqno;
+}
+
+static const char*
+flag_search_key(ImapMsgFlag flag)
+{
+  switch(flag) {
+  case IMSGF_SEEN:     return "UNSEEN";
+  case IMSGF_ANSWERED: return "ANSWERED";
+  case IMSGF_FLAGGED:  return "FLAGGED";
+  case IMSGF_DELETED:  return "DELETED";
+  case IMSGF_DRAFT:    return "DRAFT";
+  case IMSGF_RECENT:   return "RECENT";
+  default:             return NULL;
+  }
+}
+
+/* imap_assure_needed_flags loads the needed flags of all messages for
+   which they are not known yet with a single command. The sequence
+   set of these messages is built in a single pass over the flag
+   cache. A single flag is searched for, with ESEARCH if available, as
+   the server returns only the matching messages; several flags are
+   loaded with one FETCH (FLAGS) instead of one SEARCH per flag. This
+   function must be called with handle locked. */
 ImapResponse
 imap_assure_needed_flags(ImapMboxHandle *h, ImapMsgFlag needed_flags)
 {
-  ImapSearchCb cb;
-  void *arg;
-  struct flag_needed_data fnd;
-  unsigned i, shift, issued_cmd = 0;
-  unsigned cmdno[32]; /* FIXME: assume no more than 32 different flags */
-  ImapMsgFlag flag[32]; /* ditto */
-  int ics;
-  gchar *cmd = NULL, *seqno;
+  struct unknown_flag_set s;
+  unsigned i, shift, flag_cnt = 0;
   ImapResponse rc = IMR_OK;
-  gchar *cmd_format;
 
   if (h->state == IMHS_DISCONNECTED)
     return IMR_SEVERED;
 
-  if(imap_mbox_handle_can_do(h, IMCAP_ESEARCH))
-    cmd_format = "SEARCH RETURN (ALL) %s %s";
-  else
-    cmd_format = "SEARCH %s %s";
-
-  cb  = h->search_cb;  h->search_cb  = (ImapSearchCb)set_flag_cache_cb;
-  arg = h->search_arg; 
-
-  fnd.handle = h;
+  s.flag = 0;
   for(shift=0; needed_flags>>shift; shift++) {
-    if((needed_flags>>shift) & 1) {
-      const char *flg;
-      fnd.flag = 1<<shift;
-      if(fnd.flag & IMSGF_SEEN)
-        for(i=0; i<h->flag_cache->len; i++) {
-          ImapFlagCache *f =
-            &g_array_index(h->flag_cache, ImapFlagCache, i);
-          if( (f->known_flags & fnd.flag) ==0)
-            f->flag_values |= fnd.flag;
-        }
-      seqno = imap_coalesce_seq_range(1, h->exists,
-				      (ImapCoalesceFunc)flag_unknown, &fnd);
-      if(!seqno) /* oops, why were we called in the first place!? */
-        continue;
-      switch(fnd.flag) {
-      case IMSGF_SEEN:     flg = "UNSEEN"; break;
-      case IMSGF_ANSWERED: flg = "ANSWERED"; break;
-      case IMSGF_FLAGGED:  flg = "FLAGGED"; break;
-      case IMSGF_DELETED:  flg = "DELETED"; break;
-      case IMSGF_DRAFT:    flg = "DRAFT"; break;
-      case IMSGF_RECENT:   flg = "RECENT"; break;
-      default: g_free(seqno); continue;
-      }
-      if(!cmd) {
-        if (!imap_handle_idle_disable(h)) { rc = IMR_SEVERED; break; }
-      }
-      cmd = g_strdup_printf(cmd_format, seqno, flg);
-      g_free(seqno);
-      flag[issued_cmd] = fnd.flag;
-      ics = imap_cmd_start(h, cmd, &cmdno[issued_cmd++]);
-      g_free(cmd);
-      if(ics<0)
-        return IMR_SEVERED;  /* irrecoverable connection error. */
+    ImapMsgFlag f = 1<<shift;
+    if((needed_flags & f) && flag_search_key(f)) {
+      s.flag |= f;
+      flag_cnt++;
     }
   }
-  if(cmd) { /* was ever altered */
-    for(i=0; i<issued_cmd; i++) {
-      h->search_arg = &flag[i];
-      rc = imap_cmd_process_untagged(h, cmdno[i]);
+  s.seqset = g_string_new(NULL);
+  s.first  = 0;
+
+  /* SEEN is searched for as UNSEEN, so presume it is set for all
+     messages where it is not known. */
+  for(i=1; i<=h->exists; i++) {
+    ImapFlagCache *f = &g_array_index(h->flag_cache, ImapFlagCache, i-1);
+    if((f->known_flags & s.flag) == s.flag)
+      continue;
+    if(flag_cnt == 1 && (s.flag & IMSGF_SEEN))
+      f->flag_values |= IMSGF_SEEN;
+    imap_unknown_flag_set_add(&s, i);
+  }
+  imap_unknown_flag_set_close_range(&s);
+
+  if(s.seqset->len>0) {
+    gchar *cmd;
+
+    if(flag_cnt == 1) {
+      ImapSearchCb cb  = h->search_cb;
+      void        *arg = h->search_arg;
+
+      cmd = g_strdup_printf(imap_mbox_handle_can_do(h, IMCAP_ESEARCH)
+                            ? "SEARCH RETURN (ALL) %s %s" : "SEARCH %s %s",
+                            s.seqset->str, flag_search_key(s.flag));
+      h->search_cb  = (ImapSearchCb)set_flag_cache_cb;
+      h->search_arg = &s.flag;
+      rc = imap_cmd_exec(h, cmd);
+      h->search_cb = cb; h->search_arg = arg;
+    } else {
+      /* ir_msg_att_flags marks all flags as known. */
+      cmd = g_strdup_printf("FETCH %s (FLAGS)", s.seqset->str);
+      rc = imap_cmd_exec(h, cmd);
     }
-    imap_handle_idle_enable(h, 30);
+    g_free(cmd);
   }
-  h->search_cb = cb; h->search_arg = arg;
+  g_string_free(s.seqset, TRUE);
+
   if(rc == IMR_OK) {
     for(i=0; i<h->flag_cache->len; i++) {
       ImapFlagCache *f =
@@ -1549,12 +1636,14 @@ imap_mbox_store_flag_a(ImapMboxHandle *h, unsigned msgcnt, unsigned*seqno,
 
 
 /* 6.4.7 COPY Command */
-/** imap_mbox_handle_copy() copies given set of seqno from the mailbox
-    selected in handle to given mailbox on same server. */
-ImapResponse
-imap_mbox_handle_copy(ImapMboxHandle* handle, unsigned cnt, unsigned *seqno,
-                      const gchar *dest,
-		      ImapSequence *ret_sequence)
+/* RFC 6851 MOVE Command */
+/* Common part of COPY and MOVE: both take the same arguments and return
+   the same COPYUID response code; MOVE additionally sends EXPUNGE
+   responses for the moved messages, before the tagged response. */
+static ImapResponse
+imap_mbox_handle_copy_move(ImapMboxHandle* handle, const gchar *command,
+                           unsigned cnt, unsigned *seqno, const gchar *dest,
+                           ImapSequence *ret_sequence)
 {
   ImapResponse rc;
 
@@ -1563,7 +1652,7 @@ imap_mbox_handle_copy(ImapMboxHandle* handle, unsigned cnt, unsigned *seqno,
   {
     gchar *mbx7 = imap_utf8_to_mailbox(dest);
     char *seq = imap_coalesce_set(cnt, seqno);
-    gchar *cmd = g_strdup_printf("COPY %s \"%s\"", seq, mbx7);
+    gchar *cmd = g_strdup_printf("%s %s \"%s\"", command, seq, mbx7);
     unsigned cmdno;
     gboolean use_uidplus = imap_mbox_handle_can_do(handle, IMCAP_UIDPLUS);
 
@@ -1590,6 +1679,33 @@ imap_mbox_handle_copy(ImapMboxHandle* handle, unsigned cnt, unsigned *seqno,
   return rc;
 }
 
+/** imap_mbox_handle_copy() copies given set of seqno from the mailbox
+    selected in handle to given mailbox on same server. */
+ImapResponse
+imap_mbox_handle_copy(ImapMboxHandle* handle, unsigned cnt, unsigned *seqno,
+                      const gchar *dest,
+		      ImapSequence *ret_sequence)
+{
+  return imap_mbox_handle_copy_move(handle, "COPY", cnt, seqno, dest,
+                                    ret_sequence);
+}
+
+/** imap_mbox_handle_move() moves given set of seqno from the mailbox
+    selected in handle to given mailbox on same server, in a single
+    command.  The server must support the MOVE extension; the moved
+    messages are expunged from the selected mailbox. */
+ImapResponse
+imap_mbox_handle_move(ImapMboxHandle* handle, unsigned cnt, unsigned *seqno,
+                      const gchar *dest,
+		      ImapSequence *ret_sequence)
+{
+  if (!imap_mbox_handle_can_do(handle, IMCAP_MOVE))
+    return IMR_NO;
+
+  return imap_mbox_handle_copy_move(handle, "MOVE", cnt, seqno, dest,
+                                    ret_sequence);
+}
+
 /* 6.4.8 UID Command */
 /* FIXME: implement */
 /* implemented as alternatives of the commands */
@@ -1749,77 +1865,57 @@ imap_mbox_sort_msgno_srv(ImapMboxHandle *handle, ImapSortKey key,
   return rc;
 }
 
-static int
-comp_unsigned(const void *a, const void *b)
+int
+imap_comp_unsigned(const void *a, const void *b)
 {
-  return ((const unsigned*)a) - ((const unsigned*)b);
+  unsigned x = *(const unsigned*)a;
+  unsigned y = *(const unsigned*)b;
+  return (x > y) - (x < y);
 }
 
-static int
-comp_imap_address(const ImapAddress *a, const ImapAddress *b)
+static const gchar*
+sort_string_key(const gchar *str, GStringChunk *chunk)
 {
-  if(a && a->name) {
-    if(b && b->name)
-      return g_ascii_strcasecmp(a->name, b->name);
-    else return 1;
-  } else
-    return -1;
-}
+  gchar *key, *p;
 
-struct SortItem {
-  ImapMessage *msg;
-  unsigned no;
-};
-static int
-comp_arrival(const void *a, const void *b)
-{
-  const ImapMessage *x = ((const struct SortItem*)a)->msg;
-  const ImapMessage *y = ((const struct SortItem*)b)->msg;
-  return x->internal_date - y->internal_date;
-}
-static int
-comp_cc(const void *a, const void *b)
-{
-  const ImapMessage *x = ((const struct SortItem*)a)->msg;
-  const ImapMessage *y = ((const struct SortItem*)b)->msg;
-  return comp_imap_address(x->envelope->cc,  y->envelope->cc);
-}
-static int
-comp_date(const void *a, const void *b)
-{
-  const ImapMessage *x = ((const struct SortItem*)a)->msg;
-  const ImapMessage *y = ((const struct SortItem*)b)->msg;
-  return x->envelope->date - y->envelope->date;
-}
-static int
-comp_from(const void *a, const void *b)
-{
-  const ImapMessage *x = ((const struct SortItem*)a)->msg;
-  const ImapMessage *y = ((const struct SortItem*)b)->msg;
-  return comp_imap_address(x->envelope->from,  y->envelope->from);
+  if(!str)
+    return NULL;
+  key = g_string_chunk_insert(chunk, str);
+  for(p = key; *p; p++)
+    *p = g_ascii_tolower(*p);
+  return key;
 }
+
 static int
-comp_size(const void *a, const void *b)
+comp_sort_no(const struct SortItem *x, const struct SortItem *y)
 {
-  const ImapMessage *x = ((const struct SortItem*)a)->msg;
-  const ImapMessage *y = ((const struct SortItem*)b)->msg;
-  return x->rfc822size - y->rfc822size;
+  return (x->no > y->no) - (x->no < y->no);
 }
-static int
-comp_subject(const void *a, const void *b)
+
+int
+imap_sort_item_comp_num(const void *a, const void *b)
 {
-  const ImapMessage *x = ((const struct SortItem*)a)->msg;
-  const ImapMessage *y = ((const struct SortItem*)b)->msg;
-  if(!x->envelope->subject) return -1;
-  if(!y->envelope->subject) return  1;
-  return g_ascii_strcasecmp(x->envelope->subject, y->envelope->subject);
+  const struct SortItem *x = a;
+  const struct SortItem *y = b;
+  if(x->num != y->num)
+    return x->num > y->num ? 1 : -1;
+  return comp_sort_no(x, y);
 }
-static int
-comp_to(const void *a, const void *b)
+
+int
+imap_sort_item_comp_str(const void *a, const void *b)
 {
-  const ImapMessage *x = ((const struct SortItem*)a)->msg;
-  const ImapMessage *y = ((const struct SortItem*)b)->msg;
-  return comp_imap_address(x->envelope->to,  y->envelope->to);
+  const struct SortItem *x = a;
+  const struct SortItem *y = b;
+  int res;
+
+  if(!x->str)
+    res = y->str ? -1 : 0;
+  else if(!y->str)
+    res = 1;
+  else
+    res = strcmp(x->str, y->str);
+  return res ? res : comp_sort_no(x, y);
 }
 
 static ImapResponse
@@ -1834,11 +1930,14 @@ imap_mbox_sort_msgno_client(ImapMboxHandle *handle, ImapSortKey key,
     
   unsigned i, fetch_cnt, *seqno_to_fetch;
   struct SortItem *sort_items;
+  GStringChunk *chunk;
 
   if(key == IMSO_MSGNO) {
     g_warning("IMSO_MSGNO not yet implemented.");
     return IMR_NO;
   }
+  /* Envelopes restored from the header cache are still there after
+   * reconnecting, so only new messages are fetched. */
   seqno_to_fetch = g_new(unsigned, cnt);
   for(i=fetch_cnt=0; i<cnt; i++) {
     ImapMessage *imsg = imap_mbox_handle_get_msg(handle, msgno[i]);
@@ -1848,34 +1947,58 @@ imap_mbox_sort_msgno_client(ImapMboxHandle *handle, ImapSortKey key,
 
   if(fetch_cnt>0) {
     ImapResponse rc;
-    qsort(seqno_to_fetch, fetch_cnt, sizeof(unsigned), comp_unsigned);
+    qsort(seqno_to_fetch, fetch_cnt, sizeof(unsigned), imap_comp_unsigned);
     g_debug("Should the client side sorting code "
            "be sorry about your bandwidth usage?");
     rc = imap_mbox_handle_fetch_set_unlocked(handle, seqno_to_fetch,
 					     fetch_cnt, fetch_type);
-    if(rc != IMR_OK)
+    if(rc != IMR_OK) {
+      g_free(seqno_to_fetch);
       return rc;
+    }
   }
   g_free(seqno_to_fetch);
 
+  switch(key) {
+  case IMSO_CC:
+  case IMSO_FROM:
+  case IMSO_SUBJECT:
+  case IMSO_TO:
+    sortfun = imap_sort_item_comp_str; break;
+  default:
+    sortfun = imap_sort_item_comp_num; break;
+  }
+
   sort_items = g_new(struct SortItem, cnt);
+  chunk = g_string_chunk_new(4096);
   for(i=0; i<cnt; i++) {
-    sort_items[i].msg = imap_mbox_handle_get_msg(handle, msgno[i]);
-    if ((sort_items[i].msg == NULL) || (sort_items[i].msg->envelope == NULL)) {
+    ImapMessage *imsg = imap_mbox_handle_get_msg(handle, msgno[i]);
+    ImapEnvelope *env;
+    ImapAddress *addr = NULL;
+
+    if (imsg == NULL || imsg->envelope == NULL) {
+      g_string_chunk_free(chunk);
       g_free(sort_items);
       return IMR_BAD;
     }
+    env = imsg->envelope;
+    sort_items[i].str = NULL;
+    sort_items[i].num = 0;
     sort_items[i].no  = msgno[i];
-  }
-  switch(key) {
-  default:
-  case IMSO_ARRIVAL: sortfun = comp_arrival; break;
-  case IMSO_CC:      sortfun = comp_cc;      break;
-  case IMSO_DATE:    sortfun = comp_date;    break;
-  case IMSO_FROM:    sortfun = comp_from;    break;
-  case IMSO_SIZE:    sortfun = comp_size;    break;
-  case IMSO_SUBJECT: sortfun = comp_subject; break;
-  case IMSO_TO:      sortfun = comp_to;      break;
+    switch(key) {
+    default:
+    case IMSO_ARRIVAL: sort_items[i].num = imsg->internal_date; break;
+    case IMSO_CC:      addr = env->cc;                          break;
+    case IMSO_DATE:    sort_items[i].num = env->date;           break;
+    case IMSO_FROM:    addr = env->from;                        break;
+    case IMSO_SIZE:    sort_items[i].num = imsg->rfc822size;    break;
+    case IMSO_SUBJECT:
+      sort_items[i].str = sort_string_key(env->subject, chunk);
+      break;
+    case IMSO_TO:      addr = env->to;                          break;
+    }
+    if(addr)
+      sort_items[i].str = sort_string_key(addr->name, chunk);
   }
   qsort(sort_items, cnt, sizeof(struct SortItem), sortfun);
   if(ascending)
@@ -1886,6 +2009,7 @@ imap_mbox_sort_msgno_client(ImapMboxHandle *handle, ImapSortKey key,
       msgno[i] = sort_items[cnt-i-1].no;
 
 
+  g_string_chunk_free(chunk);
   g_free(sort_items);
   return IMR_OK;
 }
@@ -54,6 +54,12 @@ struct ImapStatusResult {
 };
 ImapResponse imap_mbox_status(ImapMboxHandle *r, const char*what, 
                               struct ImapStatusResult *res);
+ImapResponse imap_mbox_list_status(ImapMboxHandle *r,
+                                   const char * const *mailboxes,
+                                   ImapStatusCb cb, void *arg);
+ImapResponse imap_mbox_notify_status(ImapMboxHandle *r,
+                                     const char * const *mailboxes,
+                                     ImapStatusCb cb, void *arg);
 typedef size_t (*ImapAppendFunc)(char*, size_t, void*);
 ImapResponse imap_mbox_append(ImapMboxHandle *handle, const char *mbox,
                               ImapMsgFlags flags, size_t sz, 
@@ -100,6 +106,10 @@ ImapResponse imap_mbox_handle_copy(ImapMboxHandle* handle,
 				   unsigned cnt, unsigned *seqno,
 				   const gchar *dest,
 				   ImapSequence *ret_sequence);
+ImapResponse imap_mbox_handle_move(ImapMboxHandle* handle,
+				   unsigned cnt, unsigned *seqno,
+				   const gchar *dest,
+				   ImapSequence *ret_sequence);
 
 ImapResponse imap_mbox_find_unseen(ImapMboxHandle * h, unsigned *msgcnt,
 				   unsigned **msgs);
@@ -2101,8 +2101,10 @@ ir_permanent_flags(ImapMboxHandle *h)
   return c;
 }
 
-static int
-ir_capability_data(ImapMboxHandle *handle)
+/* imap_capability_from_name returns the capability advertised as
+   atom, or IMCAP_MAX if it is not known. */
+ImapCapability
+imap_capability_from_name(const char *atom)
 {
   /* ordered identically as ImapCapability constants */
   static const char* capabilities[] = {
@@ -2110,26 +2112,36 @@ ir_capability_data(ImapMboxHandle *handle)
     "AUTH=ANONYMOUS", "AUTH=CRAM-MD5", "AUTH=GSSAPI", "AUTH=PLAIN",
     "ACL", "RIGHTS=", "BINARY", "CHILDREN",
     "COMPRESS=DEFLATE",
-    "ESEARCH", "IDLE", "LITERAL+",
-    "LOGINDISABLED", "MULTIAPPEND", "NAMESPACE", "QUOTA", "SASL-IR",
+    "ESEARCH", "IDLE", "LITERAL+", "LIST-EXTENDED", "LIST-STATUS",
+    "LOGINDISABLED", "MOVE", "MULTIAPPEND", "NAMESPACE", "NOTIFY", "QUOTA", "SASL-IR",
     "SCAN", "STARTTLS",
     "SORT", "THREAD=ORDEREDSUBJECT", "THREAD=REFERENCES",
     "UIDPLUS", "UNSELECT"
   };
   unsigned x;
+
+  for (x=0; x<G_N_ELEMENTS(capabilities); x++)
+    if (g_ascii_strncasecmp(atom, capabilities[x],
+                            strlen(capabilities[x])) == 0)
+      return (ImapCapability) x;
+  return IMCAP_MAX;
+}
+
+static int
+ir_capability_data(ImapMboxHandle *handle)
+{
   int c;
   char atom[LONG_STRING];
 
   memset (handle->capabilities, 0, sizeof (handle->capabilities));
   
   do {
+    ImapCapability x;
+
     c = imap_get_atom(handle->sio, atom, sizeof(atom));
-    for (x=0; x<G_N_ELEMENTS(capabilities); x++)
-      if (g_ascii_strncasecmp(atom, capabilities[x],
-                              strlen(capabilities[x])) == 0) {
-	handle->capabilities[x] = 1;
-	break;
-      }
+    x = imap_capability_from_name(atom);
+    if (x != IMCAP_MAX)
+      handle->capabilities[x] = 1;
   } while(c==' ');
   handle->has_capabilities = TRUE;
   return c;
@@ -2473,6 +2485,8 @@ ir_status(ImapMboxHandle *h)
   int c;
   char *name;
   struct ImapStatusResult *resp;
+  struct ImapStatusResult all[IMSTAT_NONE+1];
+  unsigned n_all = 0;
 
   name = imap_get_astring(h->sio, &c);
   resp = g_hash_table_lookup(h->status_resps, name);
@@ -2480,16 +2494,22 @@ ir_status(ImapMboxHandle *h)
   if(sio_getc(h->sio) != '(') {g_free(name); return IMR_PROTOCOL;}
   do {
     char item[13], count[13]; /* longest than UIDVALIDITY */
+    unsigned idx;
     c = imap_get_atom(h->sio, item, sizeof(item));
     if(c == ')') break;
     if(c != ' ') {g_free(name); return IMR_PROTOCOL;}
     c = imap_get_atom(h->sio, count, sizeof(count));
-    /* FIXME: process the response */
+    for(idx=0; idx<G_N_ELEMENTS(imap_status_item_names); idx++)
+      if(g_ascii_strcasecmp(item, imap_status_item_names[idx]) == 0)
+        break;
+    if(h->status_cb && idx < G_N_ELEMENTS(imap_status_item_names) &&
+       n_all < IMSTAT_NONE) {
+      all[n_all].item = idx;
+      if (sscanf(count, "%13u", &all[n_all].result) == 1)
+        n_all++;
+    }
     if(resp) {
-      unsigned idx, i;
-      for(idx=0; idx<G_N_ELEMENTS(imap_status_item_names); idx++)
-        if(g_ascii_strcasecmp(item, imap_status_item_names[idx]) == 0)
-          break;
+      unsigned i;
       for(i= 0; resp[i].item != IMSTAT_NONE; i++) {
         if(resp[i].item == idx) {
           if (sscanf(count, "%13u", &resp[i].result) != 1) {
@@ -2501,6 +2521,12 @@ ir_status(ImapMboxHandle *h)
       }
     }
   } while(c == ' ');
+  if(h->status_cb) {
+    gchar *mbx = imap_mailbox_to_utf8(name);
+    all[n_all].item = IMSTAT_NONE;
+    h->status_cb(h, mbx, all, h->status_arg);
+    g_free(mbx);
+  }
   g_free(name);
   /* g_return_val_if-fail(c == ')', IMR_BAD) */
   return ir_check_crlf(h, sio_getc(h->sio));
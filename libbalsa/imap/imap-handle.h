@@ -52,7 +52,7 @@ typedef enum {
 typedef char ImapCmdTag[7]; /* Imap command tag */
 
 /* Capabilities recognized by the library. Add new ones alphabetically
- * and modify ir_capability_data() accordingly. */
+ * and modify imap_capability_from_name() accordingly. */
 typedef enum
 {
   IMCAP_IMAP4 = 0,
@@ -70,9 +70,13 @@ typedef enum
   IMCAP_ESEARCH,                /* RFC 4731 */
   IMCAP_IDLE,                   /* RFC 2177 */
   IMCAP_LITERAL,                /* RFC 2088 */
+  IMCAP_LIST_EXTENDED,          /* RFC 5258 */
+  IMCAP_LIST_STATUS,            /* RFC 5819 */
   IMCAP_LOGINDISABLED,		/* RFC 2595 */
+  IMCAP_MOVE,                   /* RFC 6851 */
   IMCAP_MULTIAPPEND,            /* RFC 3502 */
   IMCAP_NAMESPACE,              /* RFC 2342: IMAP4 Namespace */
+  IMCAP_NOTIFY,                 /* RFC 5465 */
   IMCAP_QUOTA,                  /* RFC 2087 */
   IMCAP_SASLIR,                 /* RFC 4959 */
   IMCAP_SCAN,                   /* FIXME: RFC? */
@@ -116,6 +120,9 @@ typedef void (*ImapFlagsCb)(unsigned cnt, const unsigned seqno[], void *arg);
 typedef void (*ImapSearchCb)(ImapMboxHandle*handle, unsigned seqno, void *arg);
 typedef void(*ImapListCb)(ImapMboxHandle*handle, int delim,
                           const char* mbox, gboolean *flags, void*);
+struct ImapStatusResult;
+typedef void (*ImapStatusCb)(ImapMboxHandle *h, const char *mbox,
+                             const struct ImapStatusResult *res, void *arg);
 
 
 ImapMboxHandle *imap_mbox_handle_new(void);
@@ -109,6 +109,9 @@ struct _ImapMboxHandle {
   void *search_arg;
 
   GHashTable *status_resps; /* A hash of STATUS responses that we wait for */
+  ImapStatusCb status_cb;   /* called for every STATUS response, e.g. from
+                             * LIST-STATUS or NOTIFY */
+  void *status_arg;
 
   GSource *sock_source;
   GMutex mutex;
@@ -192,6 +195,31 @@ ImapResponse imap_search_exec_unlocked(ImapMboxHandle *h, gboolean uid,
 ImapResponse imap_assure_needed_flags(ImapMboxHandle *h,
                                       ImapMsgFlag needed_flags);
 
+/* The set of messages for which a searched flag is not known yet, built
+   as a sequence set of coalesced ranges. */
+struct unknown_flag_set {
+  ImapMsgFlag flag;
+  GString    *seqset;
+  unsigned    first, last; /* current range, first==0 if none */
+};
+void imap_unknown_flag_set_add(struct unknown_flag_set *s, unsigned seqno);
+void imap_unknown_flag_set_close_range(struct unknown_flag_set *s);
+
+/* The sort keys of client side sorting are extracted from the
+ * envelopes once, before sorting, so that the comparison functions
+ * only compare plain strings or numbers. Ties are broken by message
+ * number, as with server side SORT. */
+struct SortItem {
+  const gchar *str; /* lowercased name or subject, or NULL */
+  gint64 num;       /* date or size */
+  unsigned no;
+};
+int imap_sort_item_comp_num(const void *a, const void *b);
+int imap_sort_item_comp_str(const void *a, const void *b);
+int imap_comp_unsigned(const void *a, const void *b);
+
+ImapCapability imap_capability_from_name(const char *atom);
+
 void imap_handle_disconnect(ImapMboxHandle *h);
 ImapConnectionState imap_mbox_handle_get_state(ImapMboxHandle *h);
 void imap_mbox_handle_set_state(ImapMboxHandle *h,
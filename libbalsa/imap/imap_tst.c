@@ -33,6 +33,7 @@
 #include "libimap.h"
 #include "imap-handle.h"
 #include "imap-commands.h"
+#include "imap_private.h"
 #include "util.h"
 
 struct {
@@ -570,6 +571,173 @@ test_mailbox_name_quoting()
   return failure_count;
 }
 
+/** test the mailbox lists of LIST-EXTENDED and NOTIFY. */
+static int
+test_mailbox_list_string()
+{
+  static const char * const one[] = { "INBOX", NULL };
+  static const char * const several[] = {
+    "INBOX", "ångström", "quot\"ed\"", "dir\\mbox", NULL
+  };
+  static const struct {
+    const char * const *test;
+    const char *reference;
+  } test_lists[] = {
+    { one, "\"INBOX\"" },
+    { several, "\"INBOX\" \"&AOU-ngstr&APY-m\" \"quot\\\"ed\\\"\" "
+      "\"dir\\\\mbox\"" }
+  };
+  int failure_count = 0;
+  unsigned i;
+  for(i=0; i<G_N_ELEMENTS(test_lists); ++i) {
+    gchar *list = imap_mailbox_list_string(test_lists[i].test);
+    if (strcmp(list, test_lists[i].reference) != 0) {
+      printf("Mailbox list %u expected '%s' found '%s'\n",
+             i, test_lists[i].reference, list);
+      ++failure_count;
+    }
+    g_free(list);
+  }
+  return failure_count;
+}
+
+/** test the sequence sets of messages with unknown flags. */
+static int
+test_unknown_flag_set()
+{
+  static const unsigned none[] = { 0 };
+  static const unsigned single[] = { 4, 0 };
+  static const unsigned ranges[] = { 1, 2, 3, 5, 7, 8, 10, 0 };
+  static const unsigned gaps[] = { 2, 4, 6, 7, 8, 9, 0 };
+  static const struct {
+    const unsigned *test; /* 0-terminated */
+    const char *reference;
+  } test_sets[] = {
+    { none, "" },
+    { single, "4" },
+    { ranges, "1:3,5,7:8,10" },
+    { gaps, "2,4,6:9" }
+  };
+  int failure_count = 0;
+  unsigned i, j;
+  for(i=0; i<G_N_ELEMENTS(test_sets); ++i) {
+    struct unknown_flag_set s;
+    s.flag = IMSGF_SEEN;
+    s.seqset = g_string_new(NULL);
+    s.first = 0;
+    for(j=0; test_sets[i].test[j] != 0; j++)
+      imap_unknown_flag_set_add(&s, test_sets[i].test[j]);
+    imap_unknown_flag_set_close_range(&s);
+    /* closing twice must not add anything */
+    imap_unknown_flag_set_close_range(&s);
+    if (strcmp(s.seqset->str, test_sets[i].reference) != 0) {
+      printf("Flag set %u expected '%s' found '%s'\n",
+             i, test_sets[i].reference, s.seqset->str);
+      ++failure_count;
+    }
+    g_string_free(s.seqset, TRUE);
+  }
+  return failure_count;
+}
+
+/** test the detection of advertised capabilities. */
+static int
+test_capability_names()
+{
+  static const struct {
+    const char *test;
+    ImapCapability reference;
+  } test_capabilities[] = {
+    { "MOVE", IMCAP_MOVE },
+    { "move", IMCAP_MOVE },
+    { "MULTIAPPEND", IMCAP_MULTIAPPEND },
+    { "LIST-EXTENDED", IMCAP_LIST_EXTENDED },
+    { "LIST-STATUS", IMCAP_LIST_STATUS },
+    { "NOTIFY", IMCAP_NOTIFY },
+    { "UIDPLUS", IMCAP_UIDPLUS },
+    { "UNSELECT", IMCAP_UNSELECT },
+    { "X-UNKNOWN", IMCAP_MAX }
+  };
+  int failure_count = 0;
+  unsigned i;
+  for(i=0; i<G_N_ELEMENTS(test_capabilities); ++i) {
+    ImapCapability cap =
+      imap_capability_from_name(test_capabilities[i].test);
+    if (cap != test_capabilities[i].reference) {
+      printf("Capability '%s' expected %d found %d\n",
+             test_capabilities[i].test,
+             test_capabilities[i].reference, cap);
+      ++failure_count;
+    }
+  }
+  return failure_count;
+}
+
+/** checks that items sorted with sortfun come out in the order of
+    their message numbers. */
+static int
+check_sort_items(const char *name, struct SortItem *items, unsigned cnt,
+                 int (*sortfun)(const void *a, const void *b))
+{
+  unsigned i;
+  qsort(items, cnt, sizeof(struct SortItem), sortfun);
+  for(i=0; i<cnt; i++) {
+    if(items[i].no != i+1) {
+      printf("Sorting by %s: expected message %u at %u, found %u\n",
+             name, i+1, i, items[i].no);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+/** test the ordering of the client side sort keys. */
+static int
+test_sort_keys()
+{
+  /* Missing strings come first, equal keys are ordered by message
+     number. */
+  struct SortItem str_items[] = {
+    { "b",   0, 7 },
+    { NULL,  0, 2 },
+    { "a",   0, 5 },
+    { "ab",  0, 6 },
+    { "",    0, 3 },
+    { NULL,  0, 1 },
+    { "a",   0, 4 }
+  };
+  /* Dates before 1970 and sizes beyond 4 GB must not wrap. */
+  struct SortItem num_items[] = {
+    { NULL, G_GINT64_CONSTANT(0x100000000), 5 },
+    { NULL, -1, 1 },
+    { NULL, 10, 3 },
+    { NULL, 0,  2 },
+    { NULL, 10, 4 }
+  };
+  unsigned seqnos[] = { 7, 1, 4000000000U, 3, 1 };
+  static const unsigned sorted_seqnos[] = { 1, 1, 3, 7, 4000000000U };
+  int failure_count = 0;
+  unsigned i;
+
+  failure_count += check_sort_items("string", str_items,
+                                    G_N_ELEMENTS(str_items),
+                                    imap_sort_item_comp_str);
+  failure_count += check_sort_items("number", num_items,
+                                    G_N_ELEMENTS(num_items),
+                                    imap_sort_item_comp_num);
+
+  qsort(seqnos, G_N_ELEMENTS(seqnos), sizeof(unsigned), imap_comp_unsigned);
+  for(i=0; i<G_N_ELEMENTS(seqnos); i++) {
+    if(seqnos[i] != sorted_seqnos[i]) {
+      printf("Sorting message numbers: expected %u at %u, found %u\n",
+             sorted_seqnos[i], i, seqnos[i]);
+      ++failure_count;
+      break;
+    }
+  }
+  return failure_count;
+}
+
 static unsigned
 process_options(int argc, char *argv[])
 {
@@ -599,9 +767,15 @@ process_options(int argc, char *argv[])
 int
 main(int argc, char *argv[]) {
   if(argc<=1) {
+    int failure_count = 0;
     test_envelope_strings();
     test_body_strings();
-    test_mailbox_name_quoting();
+    failure_count += test_mailbox_name_quoting();
+    failure_count += test_mailbox_list_string();
+    failure_count += test_unknown_flag_set();
+    failure_count += test_sort_keys();
+    failure_count += test_capability_names();
+    return failure_count > 0 ? 1 : 0;
   } else {
     static const struct {
       int (*func)(int argc, char *argv[]);
@@ -191,6 +191,25 @@ imap_mailbox_to_utf8(const gchar *mbox)
 	return g_string_free(buffer, FALSE);
 }
 
+/* imap_mailbox_list_string: returns the mailboxes as a space-separated
+ * list of quoted strings in modified UTF-7, e.g. "INBOX" "Lists/balsa",
+ * for the multiple patterns of LIST-EXTENDED and the NOTIFY mailbox
+ * filters. */
+gchar *
+imap_mailbox_list_string(const char * const *mailboxes)
+{
+	GString *str = g_string_new(NULL);
+	unsigned i;
+
+	for (i = 0; mailboxes[i] != NULL; i++) {
+		gchar *mbx7 = imap_utf8_to_mailbox(mailboxes[i]);
+
+		g_string_append_printf(str, "%s\"%s\"", (i > 0) ? " " : "", mbx7);
+		g_free(mbx7);
+	}
+	return g_string_free(str, FALSE);
+}
+
 #if 0
 int main(int argc, char *argv[])
 {
@@ -28,5 +28,7 @@ gchar* imap_mailbox_to_utf8(const char *src)
 	G_GNUC_WARN_UNUSED_RESULT;
 gchar* imap_utf8_to_mailbox(const char *src)
 	G_GNUC_WARN_UNUSED_RESULT;
+gchar *imap_mailbox_list_string(const char * const *mailboxes)
+	G_GNUC_WARN_UNUSED_RESULT;
 
 #endif
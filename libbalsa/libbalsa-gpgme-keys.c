@@ -53,6 +53,14 @@ static gboolean list_keys_real(gpgme_ctx_t            ctx,
 							   gpgme_keylist_mode_t   keylist_mode,
 							   gboolean	              list_bad_keys,
 							   GError               **error);
+static gboolean list_keys_ext_real(gpgme_ctx_t            ctx,
+								   GList                **keys,
+								   guint                 *bad_keys,
+								   const gchar          **patterns,
+								   gboolean               secret,
+								   gpgme_keylist_mode_t   keylist_mode,
+								   gboolean	              list_bad_keys,
+								   GError               **error);
 static gboolean list_local_pubkeys_real(gpgme_ctx_t           ctx,
 										GList               **keys,
 										InternetAddressList  *addresses,
@@ -101,6 +109,20 @@ libbalsa_gpgme_list_keys(gpgme_ctx_t   ctx,
 }
 
 
+/* documentation: see header file */
+gboolean
+libbalsa_gpgme_list_keys_ext(gpgme_ctx_t   ctx,
+							 GList       **keys,
+							 const gchar **patterns,
+							 gboolean      secret,
+							 GError      **error)
+{
+	g_return_val_if_fail((ctx != NULL) && (keys != NULL) && (patterns != NULL) && (patterns[0] != NULL), FALSE);
+
+	return list_keys_ext_real(ctx, keys, NULL, patterns, secret, GPGME_KEYLIST_MODE_LOCAL, FALSE, error);
+}
+
+
 /* documentation: see header file */
 gboolean
 libbalsa_gpgme_list_local_pubkeys(gpgme_ctx_t           ctx,
@@ -467,11 +489,58 @@ list_keys_real(gpgme_ctx_t            ctx,
 			   gpgme_keylist_mode_t   keylist_mode,
 			   gboolean	              list_bad_keys,
 			   GError               **error)
+{
+	const gchar *patterns[2];
+
+	patterns[0] = pattern;
+	patterns[1] = NULL;
+	return list_keys_ext_real(ctx, keys, bad_keys, (pattern != NULL) ? patterns : NULL, secret, keylist_mode, list_bad_keys,
+		error);
+}
+
+
+/** \brief Report a key listing error
+ *
+ * \param error filled with error information, may be NULL
+ * \param gpgme_err GpgME error code
+ * \param pattern all search patterns, joined, or NULL if all keys were listed
+ */
+static void
+list_keys_set_error(GError        **error,
+					gpgme_error_t   gpgme_err,
+					const gchar    *pattern)
+{
+	if (pattern != NULL) {
+		libbalsa_gpgme_set_error(error, gpgme_err, _("could not list keys for “%s”"), pattern);
+	} else {
+		libbalsa_gpgme_set_error(error, gpgme_err, _("could not list keys"));
+	}
+}
+
+
+/** \brief List keys matching any of several patterns
+ *
+ * \param patterns NULL-terminated array of search patterns, or NULL to list all keys
+ *
+ * See list_keys_real() for the other parameters.  All keys are listed in a single key list operation.
+ */
+static gboolean
+list_keys_ext_real(gpgme_ctx_t            ctx,
+				   GList                **keys,
+				   guint                 *bad_keys,
+				   const gchar          **patterns,
+				   gboolean               secret,
+				   gpgme_keylist_mode_t   keylist_mode,
+				   gboolean	              list_bad_keys,
+				   GError               **error)
 {
 	gpgme_error_t gpgme_err;
 	gpgme_keylist_mode_t kl_save;
 	gpgme_keylist_mode_t kl_mode;
+	gchar *pattern;
 
+	/* for error messages */
+	pattern = (patterns != NULL) ? g_strjoinv("”, “", (gchar **) patterns) : NULL;
 	kl_save = gpgme_get_keylist_mode(ctx);
 	kl_mode = (kl_save & ~(GPGME_KEYLIST_MODE_LOCAL | GPGME_KEYLIST_MODE_EXTERN)) | keylist_mode;
 	gpgme_err = gpgme_set_keylist_mode(ctx, kl_mode);
@@ -479,9 +548,9 @@ list_keys_real(gpgme_ctx_t            ctx,
 		libbalsa_gpgme_set_error(error, gpgme_err, _("error setting key list mode"));
 	} else {
 		/* list keys */
-		gpgme_err = gpgme_op_keylist_start(ctx, pattern, (int) secret);
+		gpgme_err = gpgme_op_keylist_ext_start(ctx, patterns, (int) secret, 0);
 		if (gpgme_err != GPG_ERR_NO_ERROR) {
-			libbalsa_gpgme_set_error(error, gpgme_err, _("could not list keys for “%s”"), pattern);
+			list_keys_set_error(error, gpgme_err, pattern);
 		} else {
 			guint bad = 0U;
 
@@ -499,7 +568,7 @@ list_keys_real(gpgme_ctx_t            ctx,
 						gpgme_key_unref(key);
 					}
 				} else if (gpgme_err_code(gpgme_err) != GPG_ERR_EOF) {
-					libbalsa_gpgme_set_error(error, gpgme_err, _("could not list keys for “%s”"), pattern);
+					list_keys_set_error(error, gpgme_err, pattern);
 				} else {
 					/* nothing to do, see MISRA C:2012, Rule 15.7 */
 				}
@@ -518,6 +587,7 @@ list_keys_real(gpgme_ctx_t            ctx,
 		}
 	}
 	gpgme_set_keylist_mode(ctx, kl_save);
+	g_free(pattern);
 
 	return (gpgme_err_code(gpgme_err) == GPG_ERR_EOF);
 }
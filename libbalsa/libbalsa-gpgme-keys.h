@@ -62,6 +62,24 @@ gboolean libbalsa_gpgme_list_keys(gpgme_ctx_t   ctx,
 								  gboolean      list_bad_keys,
 								  GError      **error);
 
+/** \brief List keys matching any of several patterns
+ *
+ * \param ctx GpgME context
+ * \param keys filled with a list of gpgme_key_t items matching any of the search patterns, filled with NULL on error
+ * \param patterns NULL-terminated array of key search patterns, must contain at least one pattern
+ * \param secret TRUE to search for private keys, FALSE to search for public keys
+ * \param error filled with error information on error, may be NULL
+ * \return TRUE on success, or FALSE if any error occurred
+ *
+ * Same as libbalsa_gpgme_list_keys() for valid keys only, but all patterns are searched in a single key list operation, which is
+ * considerably faster than one operation per pattern.
+ */
+gboolean libbalsa_gpgme_list_keys_ext(gpgme_ctx_t   ctx,
+									  GList       **keys,
+									  const gchar **patterns,
+									  gboolean      secret,
+									  GError      **error);
+
 /** \brief List local public keys
  *
  * \param ctx GpgME context
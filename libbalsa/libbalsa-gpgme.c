@@ -30,6 +30,7 @@
 #include <gpgme.h>
 #include <glib.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 #include <gtk/gtk.h>
 #include <gmime/gmime.h>
 #include "gmime-gpgme-signature.h"
@@ -78,6 +79,18 @@ static const gchar *get_utf8_locale(int category);
 static void gpg_check_capas(const gchar *gpg_path,
 							const gchar *version);
 
+static gchar *verify_cache_key(GMimeStream      *content,
+							   GMimeStream      *signature,
+							   gpgme_protocol_t  protocol)
+	G_GNUC_WARN_UNUSED_RESULT;
+static gint64 keyring_stamp(void);
+static GMimeGpgmeSigstat *verify_cache_lookup(const gchar *key,
+											  gint64       stamp)
+	G_GNUC_WARN_UNUSED_RESULT;
+static void verify_cache_store(gchar             *key,
+							   gint64             stamp,
+							   GMimeGpgmeSigstat *sigstat);
+
 
 static gboolean has_proto_openpgp = FALSE;
 static gboolean has_proto_cms = FALSE;
@@ -86,6 +99,23 @@ static gpg_capabilities gpg_capas;
 static lbgpgme_select_key_cb select_key_cb = NULL;
 static lbgpgme_accept_low_trust_cb accept_low_trust_cb = NULL;
 
+/* Verifying a detached signature runs gpg or gpgsm every time a signed
+ * message is displayed or printed, so the results are cached, keyed by
+ * a hash of the signed data and the signature.  A result is dropped
+ * when the key ring or the trust data changed, or after
+ * VERIFY_CACHE_LIFETIME, as the key may have expired in the meantime. */
+#define VERIFY_CACHE_LIFETIME	(10 * 60 * G_USEC_PER_SEC)
+#define VERIFY_CACHE_MAX_ITEMS	256U
+
+typedef struct {
+	GMimeGpgmeSigstat *sigstat;
+	gint64 keyring_stamp;
+	gint64 expires;
+} verify_cache_item_t;
+
+static GHashTable *verify_cache = NULL;
+G_LOCK_DEFINE_STATIC(verify_cache);
+
 
 /** \brief Initialise GpgME
  *
@@ -352,6 +382,8 @@ libbalsa_gpgme_verify(GMimeStream * content, GMimeStream * sig_plain,
     gpgme_data_t cont_data;
     gpgme_data_t sig_plain_data;
     GMimeGpgmeSigstat *result;
+    gchar *cache_key = NULL;
+    gint64 stamp = 0;
 
     /* paranoia checks */
     g_return_val_if_fail(GMIME_IS_STREAM(content), NULL);
@@ -359,9 +391,23 @@ libbalsa_gpgme_verify(GMimeStream * content, GMimeStream * sig_plain,
     g_return_val_if_fail(protocol == GPGME_PROTOCOL_OpenPGP ||
 			 protocol == GPGME_PROTOCOL_CMS, NULL);
 
+    /* re-use a cached result for a detached signature */
+    if (!singlepart_mode) {
+	cache_key = verify_cache_key(content, sig_plain, protocol);
+    }
+    if (cache_key != NULL) {
+	stamp = keyring_stamp();
+	result = verify_cache_lookup(cache_key, stamp);
+	if (result != NULL) {
+	    g_free(cache_key);
+	    return result;
+	}
+    }
+
     /* create the GpgME context */
     ctx = libbalsa_gpgme_new_with_proto(protocol, error);
     if (ctx == NULL) {
+	g_free(cache_key);
     	return NULL;
     }
 
@@ -372,6 +418,7 @@ libbalsa_gpgme_verify(GMimeStream * content, GMimeStream * sig_plain,
     	libbalsa_gpgme_set_error(error, err,
 			       _("could not get data from stream"));
 	gpgme_release(ctx);
+	g_free(cache_key);
 	return NULL;
     }
 
@@ -384,6 +431,7 @@ libbalsa_gpgme_verify(GMimeStream * content, GMimeStream * sig_plain,
 			       _("could not get data from stream"));
 	gpgme_data_release(cont_data);
 	gpgme_release(ctx);
+	g_free(cache_key);
 	return NULL;
     }
 
@@ -400,6 +448,11 @@ libbalsa_gpgme_verify(GMimeStream * content, GMimeStream * sig_plain,
     } else
 	result = g_mime_gpgme_sigstat_new_from_gpgme_ctx(ctx);
 
+    if ((cache_key != NULL) && (err == GPG_ERR_NO_ERROR))
+	verify_cache_store(cache_key, stamp, result);
+    else
+	g_free(cache_key);
+
     /* release gmgme data buffers, destroy the context and return the
      * signature object */
     gpgme_data_release(cont_data);
@@ -1253,3 +1306,143 @@ gpg_check_capas(const gchar *gpg_path, const gchar *version)
 	}
 	g_debug("%s supports '--export-filter drop-subkey=...': %d", gpg_path, gpg_capas.export_filter_subkey);
 }
+
+
+/** \brief Get the signature verification cache key
+ *
+ * \param content signed matter
+ * \param signature detached signature
+ * \param protocol GpgME crypto protocol of the signature
+ * \return the SHA-256 hash of the protocol, the signed matter and the signature, or NULL if the data is not available in memory
+ */
+static gchar *
+verify_cache_key(GMimeStream *content, GMimeStream *signature, gpgme_protocol_t protocol)
+{
+	GByteArray *content_data;
+	GByteArray *sig_data;
+	GChecksum *checksum;
+	guint64 content_len;
+	gchar *result;
+
+	if (!GMIME_IS_STREAM_MEM(content) || !GMIME_IS_STREAM_MEM(signature)) {
+		return NULL;
+	}
+	content_data = g_mime_stream_mem_get_byte_array(GMIME_STREAM_MEM(content));
+	sig_data = g_mime_stream_mem_get_byte_array(GMIME_STREAM_MEM(signature));
+	if ((content_data == NULL) || (sig_data == NULL)) {
+		return NULL;
+	}
+
+	checksum = g_checksum_new(G_CHECKSUM_SHA256);
+	g_checksum_update(checksum, (const guchar *) &protocol, sizeof(protocol));
+	content_len = content_data->len;
+	g_checksum_update(checksum, (const guchar *) &content_len, sizeof(content_len));
+	g_checksum_update(checksum, content_data->data, content_data->len);
+	g_checksum_update(checksum, sig_data->data, sig_data->len);
+	result = g_strdup(g_checksum_get_string(checksum));
+	g_checksum_free(checksum);
+
+	return result;
+}
+
+
+/** \brief Get a stamp of the key ring state
+ *
+ * \return a value which changes when the public key ring or the trust data in the GnuPG home folder are modified
+ *
+ * \note With GnuPG 2.4 and \em use-keyboxd, the public keys are stored by keyboxd in the SQLite database
+ *       public-keys.d/pubring.db, which may be changed through its write-ahead log only.
+ */
+static gint64
+keyring_stamp(void)
+{
+	static const gchar * const files[] = {
+		"pubring.kbx", "pubring.gpg", "public-keys.d/pubring.db", "public-keys.d/pubring.db-wal", "trustdb.gpg",
+		"trustlist.txt", NULL
+	};
+	const gchar *home_dir;
+	gint64 stamp = 0;
+	guint n;
+
+	home_dir = gpgme_get_dirinfo("homedir");
+	if (home_dir != NULL) {
+		for (n = 0U; files[n] != NULL; n++) {
+			gchar *path;
+			GStatBuf st;
+
+			path = g_build_filename(home_dir, files[n], NULL);
+			if (g_stat(path, &st) == 0) {
+				stamp += (gint64) st.st_mtime + (gint64) st.st_size;
+			}
+			g_free(path);
+		}
+	}
+
+	return stamp;
+}
+
+
+/** \brief Look up a signature verification result
+ *
+ * \param key verification cache key
+ * \param stamp current key ring stamp
+ * \return a new reference to the cached signature status, or NULL if it is not available or outdated
+ */
+static GMimeGpgmeSigstat *
+verify_cache_lookup(const gchar *key, gint64 stamp)
+{
+	GMimeGpgmeSigstat *result = NULL;
+
+	G_LOCK(verify_cache);
+	if (verify_cache != NULL) {
+		verify_cache_item_t *item;
+
+		item = g_hash_table_lookup(verify_cache, key);
+		if (item != NULL) {
+			if ((item->keyring_stamp == stamp) && (item->expires > g_get_monotonic_time())) {
+				g_debug("%s: re-use verification result %s", __func__, key);
+				result = g_object_ref(item->sigstat);
+			} else {
+				g_hash_table_remove(verify_cache, key);
+			}
+		}
+	}
+	G_UNLOCK(verify_cache);
+
+	return result;
+}
+
+
+static void
+verify_cache_item_free(verify_cache_item_t *item)
+{
+	g_object_unref(item->sigstat);
+	g_free(item);
+}
+
+
+/** \brief Store a signature verification result
+ *
+ * \param key verification cache key, the cache takes ownership
+ * \param stamp key ring stamp at the time of the verification
+ * \param sigstat signature status
+ */
+static void
+verify_cache_store(gchar *key, gint64 stamp, GMimeGpgmeSigstat *sigstat)
+{
+	verify_cache_item_t *item;
+
+	item = g_new(verify_cache_item_t, 1U);
+	item->sigstat = g_object_ref(sigstat);
+	item->keyring_stamp = stamp;
+	item->expires = g_get_monotonic_time() + VERIFY_CACHE_LIFETIME;
+
+	G_LOCK(verify_cache);
+	if (verify_cache == NULL) {
+		verify_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify) verify_cache_item_free);
+	} else if (g_hash_table_size(verify_cache) >= VERIFY_CACHE_MAX_ITEMS) {
+		g_hash_table_remove_all(verify_cache);
+	}
+	g_hash_table_replace(verify_cache, key, item);
+	G_UNLOCK(verify_cache);
+}
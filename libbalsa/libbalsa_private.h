@@ -33,6 +33,8 @@
 struct LibBalsaMailboxIndexEntry_ {
     gchar *from;
     gchar *subject;
+    gchar *from_key;            /* collation keys for sorting */
+    gchar *subject_key;
     time_t msg_date;
     time_t internal_date;
     unsigned short status_icon;
@@ -34,6 +34,8 @@
 #include "message.h"
 #include "misc.h"
 #include "filter-funcs.h"
+#include "sort-key.h"
+#include "thread-dates.h"
 #include "libbalsa_private.h"
 #include <glib/gi18n.h>
 
@@ -52,6 +54,10 @@ static gboolean
 libbalsa_mailbox_real_messages_copy(LibBalsaMailbox * mailbox,
                                     GArray * msgnos,
                                     LibBalsaMailbox * dest, GError **err);
+static gboolean
+libbalsa_mailbox_real_messages_move(LibBalsaMailbox * mailbox,
+                                    GArray * msgnos,
+                                    LibBalsaMailbox * dest, GError **err);
 static gboolean libbalsa_mailbox_real_can_do(LibBalsaMailbox* mailbox,
                                              enum LibBalsaMailboxCapability c);
 static void libbalsa_mailbox_real_sort(LibBalsaMailbox* mailbox,
@@ -127,6 +133,8 @@ struct _LibBalsaMailboxPrivate {
                          * displaying/columns of GtkTreeModel interface
                          * and NOTHING else. */
     GNode *msg_tree; /* the possibly filtered tree of messages */
+    GHashTable *thread_dates; /* latest date in the subtree of each
+                               * node of msg_tree that has children */
     LibBalsaCondition *view_filter; /* to choose a subset of messages
                                      * to be displayed, e.g., only
                                      * undeleted. */
@@ -159,6 +167,8 @@ struct _LibBalsaMailboxPrivate {
     guint need_threading_idle_id;
     guint run_filters_idle_id;
     guint sort_idle_id;
+    /* No node in msg_tree has a higher msgno. */
+    guint msg_tree_max_msgno;
 
     unsigned readonly : 1;
     unsigned view_filter_pending : 1;  /* a view filter has been set
@@ -171,6 +181,8 @@ struct _LibBalsaMailboxPrivate {
     unsigned no_reassemble : 1;
     /* Whether the tree has been changed since some event. */
     unsigned msg_tree_changed : 1;
+    /* Whether some nodes may be out of sort order, so lbm_sort must run. */
+    unsigned msg_tree_unsorted : 1;
     /* Whether messages have been threaded. */
     unsigned messages_threaded : 1;
     /* Whether a message should be cached. */
@@ -251,6 +263,7 @@ libbalsa_mailbox_class_init(LibBalsaMailboxClass * klass)
     klass->get_message_stream = NULL;
     klass->messages_change_flags = NULL;
     klass->messages_copy  = libbalsa_mailbox_real_messages_copy;
+    klass->messages_move  = libbalsa_mailbox_real_messages_move;
     klass->can_do = libbalsa_mailbox_real_can_do;
     klass->set_threading = NULL;
     klass->update_view_filter = NULL;
@@ -382,6 +395,15 @@ get_from_field(LibBalsaMailbox *mailbox, LibBalsaMessage *message)
     return from;
 }
 
+static void
+lbm_index_entry_set_subject_key(LibBalsaMailboxIndexEntry * entry)
+{
+    entry->subject_key =
+        libbalsa_sort_key(entry->subject != NULL ?
+                          libbalsa_chop_subject_prefixes(entry->subject) :
+                          NULL);
+}
+
 static void
 lbm_index_entry_populate_from_msg(LibBalsaMailboxIndexEntry * entry,
                                   LibBalsaMessage * message)
@@ -401,6 +423,8 @@ lbm_index_entry_populate_from_msg(LibBalsaMailboxIndexEntry * entry,
     entry->background_set = 0;
     entry->unseen        = LIBBALSA_MESSAGE_IS_UNREAD(message);
     entry->idle_pending  = 0;
+    entry->from_key      = libbalsa_sort_key(entry->from);
+    lbm_index_entry_set_subject_key(entry);
 
     libbalsa_mailbox_msgno_changed(mailbox, libbalsa_message_get_msgno(message));
 }
@@ -421,6 +445,8 @@ lbm_index_entry_free(LibBalsaMailboxIndexEntry *entry)
         {
             g_free(entry->from);
             g_free(entry->subject);
+            g_free(entry->from_key);
+            g_free(entry->subject_key);
         }
         g_free(entry);
     }
@@ -470,6 +496,7 @@ static void lbm_msgno_changed_expunged_cb(LibBalsaMailbox * mailbox,
                                           guint seqno);
 static void lbm_get_index_entry_expunged_cb(LibBalsaMailbox * mailbox,
                                             guint seqno);
+static void lbm_thread_dates_clear(LibBalsaMailboxPrivate * priv);
 
 static void
 libbalsa_mailbox_finalize(GObject * object)
@@ -504,6 +531,10 @@ libbalsa_mailbox_finalize(GObject * object)
 
     libbalsa_mailbox_view_free(priv->view);
 
+    lbm_thread_dates_clear(priv);
+    if (priv->thread_dates != NULL)
+        g_hash_table_destroy(priv->thread_dates);
+
     if (priv->changed_idle_id != 0)
         g_source_remove(priv->changed_idle_id);
 
@@ -669,6 +700,7 @@ libbalsa_mailbox_close(LibBalsaMailbox * mailbox, gboolean expunge)
             g_node_destroy(priv->msg_tree);
             priv->msg_tree = NULL;
         }
+        lbm_thread_dates_clear(priv);
         libbalsa_mailbox_free_mindex(mailbox);
         priv->stamp++;
 	priv->state = LB_MAILBOX_STATE_CLOSED;
@@ -948,6 +980,8 @@ lbm_run_filters_on_reception_idle_cb(LibBalsaMailbox * mailbox)
 
         msgnos = g_array_new(FALSE, FALSE, sizeof(guint));
 
+        /* a previous filter may have moved messages away */
+        total = libbalsa_mailbox_total_messages(mailbox);
         for (msgno = 1; msgno <= total; msgno++) {
             if (libbalsa_mailbox_message_match(mailbox, msgno, search_iter))
                 g_array_append_val(msgnos, msgno);
@@ -1256,6 +1290,90 @@ lbm_node_has_unseen_child(LibBalsaMailbox * lmm, GNode * node)
     return FALSE;
 }
 
+/* Thread dates: the latest message date in a subtree of msg_tree is
+ * needed for sorting a threaded view by date; see thread-dates.c.  The
+ * cache is protected by thread_dates_lock, as index entries may be
+ * filled in a subthread. */
+
+static GMutex thread_dates_lock;
+
+static void
+lbm_thread_dates_clear(LibBalsaMailboxPrivate * priv)
+{
+    g_mutex_lock(&thread_dates_lock);
+    if (priv->thread_dates != NULL)
+        g_hash_table_remove_all(priv->thread_dates);
+    g_mutex_unlock(&thread_dates_lock);
+}
+
+static void
+lbm_thread_dates_invalidate(LibBalsaMailboxPrivate * priv, GNode * node)
+{
+    g_mutex_lock(&thread_dates_lock);
+    if (priv->thread_dates != NULL)
+        libbalsa_thread_dates_invalidate(priv->thread_dates, node);
+    g_mutex_unlock(&thread_dates_lock);
+}
+
+static void
+lbm_thread_dates_remove(LibBalsaMailboxPrivate * priv, GNode * node)
+{
+    g_mutex_lock(&thread_dates_lock);
+    if (priv->thread_dates != NULL)
+        libbalsa_thread_dates_remove(priv->thread_dates, node);
+    g_mutex_unlock(&thread_dates_lock);
+}
+
+/* The index entry of node has been filled: raise the cached dates of
+ * node, which include its own date, and of its ancestors. */
+static void
+lbm_thread_dates_raise(LibBalsaMailboxPrivate * priv, GNode * node)
+{
+    guint msgno = GPOINTER_TO_UINT(node->data);
+    LibBalsaMailboxIndexEntry *entry;
+
+    if (msgno == 0 || priv->mindex == NULL)
+        return;
+
+    entry = LBM_GET_INDEX_ENTRY(priv, msgno);
+    if (!VALID_ENTRY(entry))
+        return;
+
+    g_mutex_lock(&thread_dates_lock);
+    if (priv->thread_dates != NULL)
+        libbalsa_thread_dates_raise(priv->thread_dates, node,
+                                    entry->msg_date);
+    g_mutex_unlock(&thread_dates_lock);
+}
+
+/* Skip a bad msgno or a NULL entry, but not its children. */
+static time_t
+lbm_message_date(GNode * node, gpointer data)
+{
+    LibBalsaMailboxPrivate *priv = data;
+    guint msgno = GPOINTER_TO_UINT(node->data);
+    LibBalsaMailboxIndexEntry *entry;
+
+    if (msgno > 0 && priv->mindex != NULL
+        && (entry = LBM_GET_INDEX_ENTRY(priv, msgno)) != NULL
+        && VALID_ENTRY(entry))
+        return entry->msg_date;
+
+    return 0;
+}
+
+/* Latest date in the subtree of node; call with thread_dates_lock
+ * held. */
+static time_t
+lbm_thread_date(LibBalsaMailboxPrivate * priv, GNode * node)
+{
+    if (priv->thread_dates == NULL)
+        priv->thread_dates = libbalsa_thread_dates_new();
+
+    return libbalsa_thread_date(priv->thread_dates, node,
+                                lbm_message_date, priv);
+}
+
 /* Protects access to priv->msgnos_changed; may be locked
  * with or without the gdk lock, so WE MUST NOT GRAB THE GDK LOCK WHILE
  * HOLDING IT. */
@@ -1382,6 +1500,8 @@ libbalsa_mailbox_msgno_changed(LibBalsaMailbox * mailbox, guint seqno)
 
     iter.user_data = NULL;
     lbm_msgno_changed(mailbox, seqno, &iter);
+    if (iter.user_data != NULL)
+        lbm_thread_dates_raise(priv, iter.user_data);
 
     /* Parents' style may need to be changed also. */
     while (iter.user_data) {
@@ -1408,6 +1528,71 @@ lbm_need_threading_idle_cb(LibBalsaMailbox *mailbox)
     return FALSE;
 }
 
+static gboolean lbm_has_valid_index_entry(LibBalsaMailbox * mailbox,
+                                          guint msgno);
+
+/*
+ * Find the place of a new node among the children of parent, so that
+ * the list stays sorted without a call to lbm_sort; returns the node
+ * after which it belongs, or NULL for the first place.  The caller's
+ * insertion point is tried first, as new messages usually belong at one
+ * end of the list; otherwise the place is found by binary search.  A
+ * GNode list has no random access, but the walk is linear in total and
+ * only O(log n) nodes are compared.
+ */
+static GNode *
+lbm_sort_find_place(LibBalsaMailbox * mailbox, GNode * parent,
+                    GNode * node, GNode * sibling)
+{
+    SortTuple new_tuple;
+    SortTuple tuple;
+    GNode *lo_node;
+    guint lo, hi;
+
+    new_tuple.offset = tuple.offset = 0;
+    new_tuple.node = node;
+    new_tuple.thread_date = 0;
+
+    if (sibling != NULL) {
+        tuple.node = sibling;
+        tuple.thread_date = 0;
+        if (mailbox_compare_func(&tuple, &new_tuple, mailbox) <= 0) {
+            if (sibling->next == NULL)
+                return sibling;
+            tuple.node = sibling->next;
+            tuple.thread_date = 0;
+            if (mailbox_compare_func(&new_tuple, &tuple, mailbox) < 0)
+                return sibling;
+        }
+    }
+
+    /* lo_node is the child at position lo; find the first child that
+     * must follow the new node. */
+    lo = 0;
+    hi = g_node_n_children(parent);
+    lo_node = parent->children;
+    while (lo < hi) {
+        guint mid = lo + (hi - lo) / 2;
+        GNode *mid_node = lo_node;
+        guint i;
+
+        for (i = lo; i < mid; i++)
+            mid_node = mid_node->next;
+        tuple.node = mid_node;
+        tuple.thread_date = 0;
+        if (mailbox_compare_func(&tuple, &new_tuple, mailbox) <= 0) {
+            lo = mid + 1;
+            lo_node = mid_node->next;
+        } else
+            hi = mid;
+    }
+
+    return lo_node != NULL ? lo_node->prev : g_node_last_child(parent);
+}
+
+/* Insert a node for a new message.  If the view is already sorted and
+ * the sort fields of the message are known, the node is put in its
+ * sorted place right away, and no call to lbm_sort is needed for it. */
 void
 libbalsa_mailbox_msgno_inserted(LibBalsaMailbox *mailbox, guint seqno,
                                 GNode * parent, GNode ** sibling)
@@ -1432,7 +1617,19 @@ libbalsa_mailbox_msgno_inserted(LibBalsaMailbox *mailbox, guint seqno,
     /* Insert node into the message tree before getting path. */
     iter.user_data = g_node_new(GUINT_TO_POINTER(seqno));
     iter.stamp = priv->stamp;
+    if (priv->messages_threaded && !priv->msg_tree_unsorted
+        && LIBBALSA_MAILBOX_GET_CLASS(mailbox)->sort ==
+        libbalsa_mailbox_real_sort
+        && (priv->view->sort_field == LB_MAILBOX_SORT_NO
+            || lbm_has_valid_index_entry(mailbox, seqno)))
+        *sibling = lbm_sort_find_place(mailbox, parent, iter.user_data,
+                                       *sibling);
+    else
+        priv->msg_tree_unsorted = TRUE;
     *sibling = g_node_insert_after(parent, *sibling, iter.user_data);
+    lbm_thread_dates_raise(priv, iter.user_data);
+    if (seqno > priv->msg_tree_max_msgno)
+        priv->msg_tree_max_msgno = seqno;
 
     if (g_signal_has_handler_pending(mailbox,
                                      libbalsa_mailbox_model_signals
@@ -1467,6 +1664,9 @@ libbalsa_mailbox_msgno_filt_in(LibBalsaMailbox *mailbox, guint seqno)
     iter.user_data = g_node_new(GUINT_TO_POINTER(seqno));
     iter.stamp = priv->stamp;
     g_node_prepend(priv->msg_tree, iter.user_data);
+    priv->msg_tree_unsorted = TRUE;
+    if (seqno > priv->msg_tree_max_msgno)
+        priv->msg_tree_max_msgno = seqno;
 
     path = gtk_tree_model_get_path(GTK_TREE_MODEL(mailbox), &iter);
     g_signal_emit(mailbox, libbalsa_mailbox_model_signals[ROW_INSERTED], 0,
@@ -1523,6 +1723,8 @@ libbalsa_mailbox_msgno_removed(LibBalsaMailbox * mailbox, guint seqno)
 
     if (seqno <= priv->mindex->len)
         g_ptr_array_remove_index(priv->mindex, seqno - 1);
+    if (seqno <= priv->msg_tree_max_msgno)
+        priv->msg_tree_max_msgno--;
 
     priv->msg_tree_changed = TRUE;
 
@@ -1534,6 +1736,7 @@ libbalsa_mailbox_msgno_removed(LibBalsaMailbox * mailbox, guint seqno)
     iter.user_data = dt.node;
     iter.stamp = priv->stamp;
     path = gtk_tree_model_get_path(GTK_TREE_MODEL(mailbox), &iter);
+    lbm_thread_dates_invalidate(priv, dt.node);
 
     /* First promote any children to the node's parent; we'll insert
      * them all before the current node, to keep the path calculation
@@ -1595,6 +1798,7 @@ libbalsa_mailbox_msgno_filt_out(LibBalsaMailbox * mailbox, GNode * node)
     iter.user_data = node;
     iter.stamp = priv->stamp;
     path = gtk_tree_model_get_path(GTK_TREE_MODEL(mailbox), &iter);
+    lbm_thread_dates_invalidate(priv, node);
 
     /* First promote any children to the node's parent; we'll insert
      * them all before the current node, to keep the path calculation
@@ -1995,6 +2199,13 @@ lbm_cache_message(LibBalsaMailbox * mailbox, guint msgno,
         need_sort = FALSE;
     }
 
+    /* A message which is not in the tree yet is put in its sorted place
+     * when it is inserted. */
+    if (need_sort && msgno <= priv->msg_tree_max_msgno)
+        priv->msg_tree_unsorted = TRUE;
+    else
+        need_sort = FALSE;
+
     if (need_sort && priv->sort_idle_id == 0) {
         priv->sort_idle_id =
             g_idle_add_full(G_PRIORITY_LOW, (GSourceFunc) lbm_sort_idle_cb,
@@ -2216,6 +2427,29 @@ libbalsa_mailbox_messages_copy(LibBalsaMailbox * mailbox, GArray * msgnos,
     return retval;
 }
 
+/* Default method: copy the messages and mark them as deleted; imap
+ * backend replaces it with a server-side move when it can. */
+static gboolean
+libbalsa_mailbox_real_messages_move(LibBalsaMailbox * mailbox,
+                                    GArray * msgnos,
+                                    LibBalsaMailbox * dest, GError ** err)
+{
+    gboolean retval;
+
+    retval = messages_copy_locked(mailbox, msgnos, dest, err);
+    if (retval) {
+        retval = libbalsa_mailbox_messages_change_flags
+            (mailbox, msgnos, LIBBALSA_MESSAGE_FLAG_DELETED,
+             (LibBalsaMessageFlag) 0);
+	if(!retval)
+	    g_set_error(err,LIBBALSA_MAILBOX_ERROR,
+                        LIBBALSA_MAILBOX_COPY_ERROR,
+			_("Removing messages from source mailbox failed"));
+    }
+
+    return retval;
+}
+
 /* Move messages with msgnos in the list from mailbox to dest. */
 gboolean
 libbalsa_mailbox_messages_move(LibBalsaMailbox * mailbox,
@@ -2231,16 +2465,7 @@ libbalsa_mailbox_messages_move(LibBalsaMailbox * mailbox,
 
     libbalsa_lock_mailbox(mailbox);
     libbalsa_lock_mailbox(dest);
-    retval = messages_copy_locked(mailbox, msgnos, dest, err);
-    if (retval) {
-        retval = libbalsa_mailbox_messages_change_flags
-            (mailbox, msgnos, LIBBALSA_MESSAGE_FLAG_DELETED,
-             (LibBalsaMessageFlag) 0);
-	if(!retval)
-	    g_set_error(err,LIBBALSA_MAILBOX_ERROR,
-                        LIBBALSA_MAILBOX_COPY_ERROR,
-			_("Removing messages from source mailbox failed"));
-    }
+    retval = LIBBALSA_MAILBOX_GET_CLASS(mailbox)->messages_move(mailbox, msgnos, dest, err);
     libbalsa_unlock_mailbox(dest);
     libbalsa_unlock_mailbox(mailbox);
 
@@ -2341,8 +2566,10 @@ lbm_sort_idle_cb(LibBalsaMailbox * mailbox)
         return G_SOURCE_CONTINUE;
     }
 
-    if (priv->msg_tree != NULL)
+    if (priv->msg_tree != NULL && priv->msg_tree_unsorted) {
         lbm_sort(mailbox, priv->msg_tree);
+        priv->msg_tree_unsorted = FALSE;
+    }
 
     libbalsa_mailbox_changed(mailbox);
 
@@ -3529,54 +3756,26 @@ static gint
 mailbox_compare_from(LibBalsaMailboxIndexEntry * message_a,
                   LibBalsaMailboxIndexEntry * message_b)
 {
-    return g_ascii_strcasecmp(message_a->from, message_b->from);
+    return g_strcmp0(message_a->from_key, message_b->from_key);
 }
 
 static gint
 mailbox_compare_subject(LibBalsaMailboxIndexEntry * message_a,
                      LibBalsaMailboxIndexEntry * message_b)
 {
-    return g_ascii_strcasecmp(message_a->subject, message_b->subject);
+    return g_strcmp0(message_a->subject_key, message_b->subject_key);
 }
 
 static gint
 mailbox_compare_date(LibBalsaMailboxIndexEntry * message_a,
                   LibBalsaMailboxIndexEntry * message_b)
 {
-    return message_a->msg_date - message_b->msg_date;
+    return (message_a->msg_date > message_b->msg_date)
+        - (message_a->msg_date < message_b->msg_date);
 }
 
 /* Thread date stuff */
 
-typedef struct {
-    time_t                  thread_date;
-    LibBalsaMailboxPrivate *priv;
-} LibBalsaMailboxThreadDateInfo;
-
-static gboolean
-mailbox_get_thread_date_traverse_func(GNode   *node,
-                                      gpointer data)
-{
-    LibBalsaMailboxThreadDateInfo *info = data;
-    guint msgno;
-    LibBalsaMailboxIndexEntry *message;
-
-    if ((msgno = GPOINTER_TO_UINT(node->data)) > 0 &&
-        msgno <= info->priv->mindex->len &&
-        (message = g_ptr_array_index(info->priv->mindex, msgno - 1)) != NULL) {
-        time_t msg_date = message->msg_date;
-
-        if (msg_date > info->thread_date)
-            info->thread_date = msg_date;
-
-        return FALSE;
-    }
-
-    /* Either a bad msgno or a NULL message: stop the traversal before
-     * something bad happens. */
-    return TRUE;
-}
-
 static time_t
 mailbox_get_thread_date(const SortTuple *tuple,
                      LibBalsaMailbox *mailbox)
@@ -3584,14 +3783,12 @@ mailbox_get_thread_date(const SortTuple *tuple,
     LibBalsaMailboxPrivate *priv = libbalsa_mailbox_get_instance_private(mailbox);
 
     if (tuple->thread_date == 0) {
-        LibBalsaMailboxThreadDateInfo info = { 0, priv };
-
-        g_node_traverse(tuple->node, G_IN_ORDER, G_TRAVERSE_ALL, -1,
-                        mailbox_get_thread_date_traverse_func, &info);
-
+        g_mutex_lock(&thread_dates_lock);
         /* Cast away the 'const' qualifier so that we can cache the
          * thread date: */
-        ((SortTuple *) tuple)->thread_date = info.thread_date;
+        ((SortTuple *) tuple)->thread_date =
+            lbm_thread_date(priv, tuple->node);
+        g_mutex_unlock(&thread_dates_lock);
     }
 
     return tuple->thread_date;
@@ -3602,7 +3799,10 @@ mailbox_compare_thread_date(const SortTuple *a,
                          const SortTuple *b,
                          LibBalsaMailbox *mailbox)
 {
-    return mailbox_get_thread_date(a, mailbox) - mailbox_get_thread_date(b, mailbox);
+    time_t date_a = mailbox_get_thread_date(a, mailbox);
+    time_t date_b = mailbox_get_thread_date(b, mailbox);
+
+    return (date_a > date_b) - (date_a < date_b);
 }
 
 /* End of thread date stuff */
@@ -3611,7 +3811,8 @@ static gint
 mailbox_compare_size(LibBalsaMailboxIndexEntry * message_a,
                   LibBalsaMailboxIndexEntry * message_b)
 {
-    return message_a->size - message_b->size;
+    return (message_a->size > message_b->size)
+        - (message_a->size < message_b->size);
 }
 
 static gint
@@ -3711,6 +3912,83 @@ lbm_has_valid_index_entry(LibBalsaMailbox * mailbox, guint msgno)
     return VALID_ENTRY(entry);
 }
 
+/*
+ * Sort a sibling list that is already sorted except for a few nodes,
+ * typically new messages whose sort fields were not known when they were
+ * inserted (see lbm_sort_find_place): the displaced nodes are inserted by
+ * binary search into the rest of the list, instead of sorting the whole
+ * list.  Only the order of sort_array is changed; the caller relinks the
+ * nodes and reorders the rows, so that the tree-view keeps the expanded
+ * threads and the selection.
+ *
+ * The rest of the list is found greedily in a single pass, and is not
+ * necessarily the longest sorted subsequence: a node which belongs far
+ * later but was moved to the front makes all nodes following it look
+ * displaced.  Returns the number of displaced nodes, or -1, without
+ * changing anything, if too many nodes are out of place; the caller
+ * then falls back to a full sort.
+ */
+#define LBM_SORT_MAX_INSERTIONS 128
+
+static gint
+lbm_sort_by_insertion(LibBalsaMailbox * mailbox, GArray * sort_array)
+{
+    GArray *sorted;
+    GArray *displaced;
+    gint retval;
+    guint i;
+
+    /* Split the list into a sorted subsequence and the rest. */
+    sorted = g_array_sized_new(FALSE, FALSE, sizeof(SortTuple),
+                               sort_array->len);
+    displaced = g_array_new(FALSE, FALSE, sizeof(SortTuple));
+    for (i = 0; i < sort_array->len; i++) {
+        SortTuple *tuple = &g_array_index(sort_array, SortTuple, i);
+
+        if (sorted->len == 0
+            || mailbox_compare_func(&g_array_index(sorted, SortTuple,
+                                                   sorted->len - 1),
+                                    tuple, mailbox) <= 0)
+            g_array_append_val(sorted, *tuple);
+        else
+            g_array_append_val(displaced, *tuple);
+    }
+
+    if (displaced->len > LBM_SORT_MAX_INSERTIONS
+        || displaced->len * 8 > sort_array->len) {
+        g_array_free(sorted, TRUE);
+        g_array_free(displaced, TRUE);
+        return -1;
+    }
+
+    for (i = 0; i < displaced->len; i++) {
+        SortTuple *tuple = &g_array_index(displaced, SortTuple, i);
+        guint lo = 0, hi = sorted->len;
+
+        /* Find the first sorted node that must follow this one. */
+        while (lo < hi) {
+            guint mid = (lo + hi) / 2;
+
+            if (mailbox_compare_func(&g_array_index(sorted, SortTuple, mid),
+                                     tuple, mailbox) <= 0)
+                lo = mid + 1;
+            else
+                hi = mid;
+        }
+        g_array_insert_val(sorted, lo, *tuple);
+    }
+
+    for (i = 0; i < sort_array->len; i++)
+        g_array_index(sort_array, SortTuple, i) =
+            g_array_index(sorted, SortTuple, i);
+
+    retval = displaced->len;
+    g_array_free(sorted, TRUE);
+    g_array_free(displaced, TRUE);
+
+    return retval;
+}
+
 static void
 lbm_sort(LibBalsaMailbox * mailbox, GNode * parent)
 {
@@ -3719,6 +3997,7 @@ lbm_sort(LibBalsaMailbox * mailbox, GNode * parent)
     GPtrArray *node_array;
     GNode *node, *tmp_node, *prev;
     guint i, j;
+    gint displaced;
     gboolean sort_no = priv->view->sort_field == LB_MAILBOX_SORT_NO;
 #if !defined(LOCAL_MAILBOX_SORTED_JUST_ONCE_ON_OPENING)
     gboolean can_sort_all = sort_no || LIBBALSA_IS_MAILBOX_IMAP(mailbox);
@@ -3756,7 +4035,24 @@ lbm_sort(LibBalsaMailbox * mailbox, GNode * parent)
         lbm_sort(mailbox, node);
         return;
     }
-    LIBBALSA_MAILBOX_GET_CLASS(mailbox)->sort(mailbox, sort_array);
+
+    displaced = -1;
+    if (sort_array->len == node_array->len
+        && LIBBALSA_MAILBOX_GET_CLASS(mailbox)->sort ==
+        libbalsa_mailbox_real_sort)
+        displaced = lbm_sort_by_insertion(mailbox, sort_array);
+
+    if (displaced == 0) {
+        /* Already in order. */
+        g_array_free(sort_array, TRUE);
+        g_ptr_array_free(node_array, TRUE);
+        for (tmp_node = parent->children; tmp_node; tmp_node = tmp_node->next)
+            lbm_sort(mailbox, tmp_node);
+        return;
+    }
+
+    if (displaced < 0)
+        LIBBALSA_MAILBOX_GET_CLASS(mailbox)->sort(mailbox, sort_array);
 
     /* Step through the nodes in original order. */
     prev = NULL;
@@ -3920,6 +4216,7 @@ mailbox_set_sort_column_id(GtkTreeSortable * sortable,
     }
     libbalsa_lock_mailbox(mailbox);
     lbm_sort(mailbox, priv->msg_tree);
+    priv->msg_tree_unsorted = FALSE;
     libbalsa_unlock_mailbox(mailbox);
 
     libbalsa_mailbox_changed(mailbox);
@@ -3969,6 +4266,10 @@ libbalsa_mailbox_unlink_and_prepend(LibBalsaMailbox * mailbox,
 
     path = mailbox_model_get_path_helper(node, priv->msg_tree);
     current_parent = node->parent;
+    if (parent == NULL)
+        lbm_thread_dates_remove(priv, node);
+    else
+        lbm_thread_dates_invalidate(priv, current_parent);
     g_node_unlink(node);
     if (path) {
         /* The node was in priv->msg_tree. */
@@ -3991,6 +4292,8 @@ libbalsa_mailbox_unlink_and_prepend(LibBalsaMailbox * mailbox,
     }
 
     g_node_prepend(parent, node);
+    lbm_thread_dates_invalidate(priv, parent);
+    priv->msg_tree_unsorted = TRUE;
     path = mailbox_model_get_path_helper(parent, priv->msg_tree);
     if (path) {
         /* The parent is in priv->msg_tree. */
@@ -4084,8 +4387,14 @@ lbm_update_msg_tree_move(GNode * new_node,
         return FALSE;
 
     node = mti->nodes[msgno];
-    if (!node)
+    if (!node) {
+        LibBalsaMailboxPrivate *priv =
+            libbalsa_mailbox_get_instance_private(mti->mailbox);
+
         mti->nodes[msgno] = node = g_node_new(new_node->data);
+        if (msgno > priv->msg_tree_max_msgno)
+            priv->msg_tree_max_msgno = msgno;
+    }
 
     msgno = GPOINTER_TO_UINT(new_node->parent->data);
     if (msgno >= mti->total)
@@ -4171,7 +4480,10 @@ libbalsa_mailbox_set_msg_tree(LibBalsaMailbox * mailbox, GNode * new_tree)
     } else {
         if (priv->msg_tree)
             g_node_destroy(priv->msg_tree);
+        lbm_thread_dates_clear(priv);
         priv->msg_tree = new_tree;
+        priv->msg_tree_max_msgno = libbalsa_mailbox_total_messages(mailbox);
+        priv->msg_tree_unsorted = TRUE;
         lbm_set_msg_tree(mailbox);
     }
 
@@ -4476,6 +4788,8 @@ libbalsa_mailbox_msgno_update_attach(LibBalsaMailbox * mailbox,
 	if (fix_subject) {
 		g_free(entry->subject);
 		entry->subject = g_strdup(subject);
+		g_free(entry->subject_key);
+		lbm_index_entry_set_subject_key(entry);
 	}
         iter.user_data = NULL;
 	lbm_msgno_changed(mailbox, msgno, &iter);
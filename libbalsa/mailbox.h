@@ -239,6 +239,8 @@ struct _LibBalsaMailboxClass {
 				       LibBalsaMessageFlag clear);
     gboolean (*messages_copy) (LibBalsaMailbox * mailbox, GArray *msgnos,
 			       LibBalsaMailbox * dest, GError **err);
+    gboolean (*messages_move) (LibBalsaMailbox * mailbox, GArray *msgnos,
+			       LibBalsaMailbox * dest, GError **err);
     /* Test message flags */
     gboolean(*msgno_has_flags) (LibBalsaMailbox * mailbox, guint msgno,
                                 LibBalsaMessageFlag set,
@@ -180,6 +180,12 @@ static gboolean libbalsa_mailbox_imap_messages_copy(LibBalsaMailbox *
 						    LibBalsaMailbox *
 						    dest,
                                                     GError **err);
+static gboolean libbalsa_mailbox_imap_messages_move(LibBalsaMailbox *
+						    mailbox,
+						    GArray * msgnos,
+						    LibBalsaMailbox *
+						    dest,
+                                                    GError **err);
 static void libbalsa_mailbox_imap_parse_set_headers(LibBalsaMessage *message,
 													const gchar     *header_str);
 
@@ -269,6 +275,8 @@ libbalsa_mailbox_imap_class_init(LibBalsaMailboxImapClass * klass)
 	libbalsa_mailbox_imap_total_messages;
     libbalsa_mailbox_class->messages_copy =
 	libbalsa_mailbox_imap_messages_copy;
+    libbalsa_mailbox_class->messages_move =
+	libbalsa_mailbox_imap_messages_move;
 }
 
 static void
@@ -1314,6 +1322,16 @@ lbm_imap_check(LibBalsaMailbox * mailbox)
     ImapMboxHandle *handle;
     gulong id;
 
+    if (!mimap->opened &&
+        libbalsa_imap_server_get_use_status(LIBBALSA_IMAP_SERVER(server))) {
+        guint unseen;
+
+        /* one LIST-STATUS (or NOTIFY) covers all checked folders */
+        if (libbalsa_imap_server_get_folder_unseen(LIBBALSA_IMAP_SERVER(server),
+                                                   mimap->path, &unseen))
+            return unseen > 0;
+    }
+
     handle = libbalsa_mailbox_imap_get_handle(mimap, NULL);
     if (!handle)
 	return FALSE;
@@ -3381,6 +3399,97 @@ libbalsa_mailbox_imap_total_messages(LibBalsaMailbox * mailbox)
     return cnt;
 }
 
+/* Server-side copy or move of messages in the list from mimap to
+ * mimap_dest on the same server; cached message files are copied for
+ * the new UIDs, if the server reports them. */
+static gboolean
+lbm_imap_server_copy(LibBalsaMailboxImap * mimap, GArray * msgnos,
+                     LibBalsaMailboxImap * mimap_dest, gboolean move,
+                     GError ** err)
+{
+    LibBalsaServer *server = LIBBALSA_MAILBOX_REMOTE_GET_SERVER(mimap);
+    gboolean ret;
+    ImapMboxHandle *handle = mimap->handle;
+    ImapSequence uid_sequence;
+    unsigned *seqno = (unsigned*)msgnos->data, *uids;
+    unsigned im;
+    g_return_val_if_fail(handle, FALSE);
+
+    imap_sequence_init(&uid_sequence);
+    /* User server-side copy. */
+    g_array_sort(msgnos, cmp_msgno);
+    uids = g_new(unsigned, msgnos->len);
+    for(im=0; im<msgnos->len; im++) {
+        ImapMessage * imsg = imap_mbox_handle_get_msg(handle, seqno[im]);
+        uids[im] = imsg ? imsg->uid : 0;
+    }
+
+    ret = (move ? imap_mbox_handle_move : imap_mbox_handle_copy)
+        (handle, msgnos->len, (guint *) msgnos->data, mimap_dest->path,
+         &uid_sequence) == IMR_OK;
+    if(!ret) {
+        gchar *msg = imap_mbox_handle_get_last_msg(handle);
+        g_set_error(err, LIBBALSA_MAILBOX_ERROR,
+                    LIBBALSA_MAILBOX_COPY_ERROR,
+                    "%s", msg);
+        g_free(msg);
+    } else if(!imap_sequence_empty(&uid_sequence)) {
+        /* Copy cache files. */
+        GDir *dir;
+        LibBalsaImapServer *imap_server = LIBBALSA_IMAP_SERVER(server);
+        gboolean is_persistent =
+            libbalsa_imap_server_has_persistent_cache(imap_server);
+        gchar *dir_name = get_cache_dir(is_persistent);
+        gchar *src_prefix = g_strdup_printf("%s@%s-%s-%u-",
+                                            libbalsa_server_get_user(server),
+                                            libbalsa_server_get_host(server),
+                                            (mimap->path
+                                             ? mimap->path : "INBOX"),
+                                            mimap->uid_validity);
+        gchar *encoded_path = libbalsa_urlencode(src_prefix);
+        g_free(src_prefix);
+        dir = g_dir_open(dir_name, 0, NULL);
+        if (dir != NULL) {
+            const gchar *filename;
+            size_t prefix_length = strlen(encoded_path);
+            unsigned nth;
+            while ((filename = g_dir_read_name(dir)) != NULL) {
+                unsigned msg_uid;
+                gchar *tail;
+                if(strncmp(encoded_path, filename, prefix_length))
+                    continue;
+                msg_uid = strtol(filename + prefix_length, &tail, 10);
+                for(im = 0; im<msgnos->len; im++) {
+                    if(uids[im]>msg_uid) break;
+                    else if(uids[im]==msg_uid &&
+                            (nth = imap_sequence_nth(&uid_sequence, im))
+                             ) {
+                        gchar *src =
+                            g_build_filename(dir_name, filename, NULL);
+                        gchar *dst_prefix =
+                            g_strdup_printf("%s@%s-%s-%u-%u%s",
+                                            libbalsa_server_get_user(server),
+                                            libbalsa_server_get_host(server),
+                                            (mimap_dest->path != NULL ?
+                                             mimap_dest->path : "INBOX"),
+                                            uid_sequence.uid_validity,
+                                            nth, tail);
+
+                        create_cache_copy(src, dir_name, dst_prefix);
+                        g_free(dst_prefix);
+                        break;
+                    }
+                }
+            }
+            g_dir_close(dir);
+        }
+        g_free(dir_name);
+    }
+    g_free(uids);
+    imap_sequence_release(&uid_sequence);
+    return ret;
+}
+
 /* Copy messages in the list to dest; use server-side copy if mailbox
  * and dest are on the same server, fall back to parent method
  * otherwise.
@@ -3393,95 +3502,47 @@ libbalsa_mailbox_imap_messages_copy(LibBalsaMailbox * mailbox,
     LibBalsaMailboxImap *mimap = LIBBALSA_MAILBOX_IMAP(mailbox);
     LibBalsaServer *server = LIBBALSA_MAILBOX_REMOTE_GET_SERVER(mimap);
 
-    if (LIBBALSA_IS_MAILBOX_IMAP(dest) && LIBBALSA_MAILBOX_REMOTE_GET_SERVER(dest) == server) {
-        LibBalsaMailboxImap *mimap_dest = (LibBalsaMailboxImap *) dest;
+    if (LIBBALSA_IS_MAILBOX_IMAP(dest) && LIBBALSA_MAILBOX_REMOTE_GET_SERVER(dest) == server)
+        return lbm_imap_server_copy(mimap, msgnos,
+                                    LIBBALSA_MAILBOX_IMAP(dest), FALSE, err);
+
+    /* Couldn't use server-side copy, fall back to default method. */
+    return LIBBALSA_MAILBOX_CLASS(libbalsa_mailbox_imap_parent_class)->
+        messages_copy(mailbox, msgnos, dest, err);
+}
+
+/* Move messages in the list to dest; use the MOVE command if mailbox
+ * and dest are on the same server and the server supports it, which
+ * replaces COPY, STORE \Deleted and EXPUNGE with one command; fall
+ * back to parent method otherwise.
+ */
+static gboolean
+libbalsa_mailbox_imap_messages_move(LibBalsaMailbox * mailbox,
+				    GArray * msgnos,
+				    LibBalsaMailbox * dest, GError **err)
+{
+    LibBalsaMailboxImap *mimap = LIBBALSA_MAILBOX_IMAP(mailbox);
+    LibBalsaServer *server = LIBBALSA_MAILBOX_REMOTE_GET_SERVER(mimap);
+
+    if (LIBBALSA_IS_MAILBOX_IMAP(dest) && LIBBALSA_MAILBOX_REMOTE_GET_SERVER(dest) == server
+        && mimap->handle != NULL
+        && imap_mbox_handle_can_do(mimap->handle, IMCAP_MOVE)) {
         gboolean ret;
-	ImapMboxHandle *handle = mimap->handle;
-	ImapSequence uid_sequence;
-	unsigned *seqno = (unsigned*)msgnos->data, *uids;
-	unsigned im;
-	g_return_val_if_fail(handle, FALSE);
-
-	imap_sequence_init(&uid_sequence);
-	/* User server-side copy. */
-	g_array_sort(msgnos, cmp_msgno);
-	uids = g_new(unsigned, msgnos->len);
-	for(im=0; im<msgnos->len; im++) {
-	    ImapMessage * imsg = imap_mbox_handle_get_msg(handle, seqno[im]);
-	    uids[im] = imsg ? imsg->uid : 0;
-	}
+        GArray *moved;
+
+        /* The moved messages are expunged while the command runs, which
+         * renumbers the caller's array; work on a copy. */
+        moved = g_array_sized_new(FALSE, FALSE, sizeof(guint), msgnos->len);
+        g_array_append_vals(moved, msgnos->data, msgnos->len);
+        ret = lbm_imap_server_copy(mimap, moved,
+                                   LIBBALSA_MAILBOX_IMAP(dest), TRUE, err);
+        g_array_free(moved, TRUE);
 
-	ret = imap_mbox_handle_copy(handle, msgnos->len,
-                                    (guint *) msgnos->data,
-                                    mimap_dest->path,
-				    &uid_sequence)
-	    == IMR_OK;
-        if(!ret) {
-            gchar *msg = imap_mbox_handle_get_last_msg(handle);
-            g_set_error(err, LIBBALSA_MAILBOX_ERROR,
-                        LIBBALSA_MAILBOX_COPY_ERROR,
-                        "%s", msg);
-            g_free(msg);
-        } else if(!imap_sequence_empty(&uid_sequence)) {
-	    /* Copy cache files. */
-	    GDir *dir;
-	    LibBalsaImapServer *imap_server = LIBBALSA_IMAP_SERVER(server);
-	    gboolean is_persistent =
-		libbalsa_imap_server_has_persistent_cache(imap_server);
-	    gchar *dir_name = get_cache_dir(is_persistent);
-	    gchar *src_prefix = g_strdup_printf("%s@%s-%s-%u-",
-						libbalsa_server_get_user(server),
-                                                libbalsa_server_get_host(server),
-						(mimap->path
-						 ? mimap->path : "INBOX"),
-						mimap->uid_validity);
-	    gchar *encoded_path = libbalsa_urlencode(src_prefix);
-	    g_free(src_prefix);
-	    dir = g_dir_open(dir_name, 0, NULL);
-	    if (dir != NULL) {
-		const gchar *filename;
-		size_t prefix_length = strlen(encoded_path);
-		unsigned nth;
-		while ((filename = g_dir_read_name(dir)) != NULL) {
-		    unsigned msg_uid;
-		    gchar *tail;
-		    if(strncmp(encoded_path, filename, prefix_length))
-			continue;
-		    msg_uid = strtol(filename + prefix_length, &tail, 10);
-		    for(im = 0; im<msgnos->len; im++) {
-			if(uids[im]>msg_uid) break;
-			else if(uids[im]==msg_uid &&
-				(nth = imap_sequence_nth(&uid_sequence, im))
-				 ) {
-			    gchar *src =
-				g_build_filename(dir_name, filename, NULL);
-			    gchar *dst_prefix =
-				g_strdup_printf("%s@%s-%s-%u-%u%s",
-						libbalsa_server_get_user(server),
-                                                libbalsa_server_get_host(server),
-						(mimap_dest->path != NULL ?
-						 mimap_dest->path : "INBOX"),
-						uid_sequence.uid_validity,
-						nth, tail);
-
-			    create_cache_copy(src, dir_name, dst_prefix);
-			    g_free(dst_prefix);
-			    break;
-			}
-		    }
-		}
-		g_dir_close(dir);
-	    }
-	    g_free(dir_name);
-	}
-	g_free(uids);
-	imap_sequence_release(&uid_sequence);
         return ret;
     }
 
-    /* Couldn't use server-side copy, fall back to default method. */
     return LIBBALSA_MAILBOX_CLASS(libbalsa_mailbox_imap_parent_class)->
-        messages_copy(mailbox, msgnos, dest, err);
+        messages_move(mailbox, msgnos, dest, err);
 }
 
 void
@@ -27,6 +27,11 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <string.h>
+#include <unistd.h>
+#ifdef HAVE_FICLONE
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif                          /* HAVE_FICLONE */
 
 #include "libbalsa.h"
 #include "libbalsa_private.h"
@@ -2126,6 +2131,65 @@ libbalsa_mailbox_local_get_message_stream(LibBalsaMailbox * mailbox,
     return stream;
 }
 
+/* Copy a message that is a whole file, as in maildir and mh, to the
+ * new file open on out_fd without passing the data through user space:
+ * share its extents (FICLONE) or let the kernel copy it
+ * (copy_file_range).  Returns FALSE, leaving out_fd empty, when the
+ * stream is not a whole file or neither method works, for example
+ * across filesystems; the caller must then stream the message.
+ *
+ * The data are not passed through the dos2unix filter, but local
+ * messages are stored with LF line ends anyway. */
+gboolean
+libbalsa_mailbox_local_clone_message(GMimeStream * stream, int out_fd)
+{
+#if defined(HAVE_FICLONE) || defined(HAVE_COPY_FILE_RANGE)
+    int in_fd;
+    struct stat st;
+
+    if (!GMIME_IS_STREAM_FS(stream)
+        || stream->bound_start != 0 || stream->bound_end != -1)
+        return FALSE;
+
+    in_fd = GMIME_STREAM_FS(stream)->fd;
+    if (fstat(in_fd, &st) < 0 || !S_ISREG(st.st_mode))
+        return FALSE;
+
+#ifdef HAVE_FICLONE
+    if (ioctl(out_fd, FICLONE, in_fd) == 0)
+        return TRUE;
+#endif                          /* HAVE_FICLONE */
+
+#ifdef HAVE_COPY_FILE_RANGE
+    {
+        off64_t in_off = 0;
+        off64_t out_off = 0;
+
+        while (in_off < st.st_size) {
+            ssize_t len;
+
+            len = copy_file_range(in_fd, &in_off, out_fd, &out_off,
+                                  st.st_size - in_off, 0);
+            if (len < 0 && errno == EINTR)
+                continue;
+            if (len <= 0) {
+                /* Unsupported, or the file changed under us: discard
+                 * what was copied and let the caller stream it. */
+                if (out_off > 0 && ftruncate(out_fd, 0) < 0)
+                    g_warning("%s: ftruncate failed: %s", __func__,
+                              g_strerror(errno));
+                return FALSE;
+            }
+        }
+
+        return TRUE;
+    }
+#endif                          /* HAVE_COPY_FILE_RANGE */
+#endif                          /* HAVE_FICLONE || HAVE_COPY_FILE_RANGE */
+
+    return FALSE;
+}
+
 /* Queued sync. */
 
 static void
@@ -84,5 +84,7 @@ GMimeStream *libbalsa_mailbox_local_get_message_stream(LibBalsaMailbox *
 						       mailbox,
 						       const gchar * name1,
 						       const gchar * name2);
+gboolean libbalsa_mailbox_local_clone_message(GMimeStream * stream,
+                                              int out_fd);
 
 #endif				/* __LIBBALSA_MAILBOX_LOCAL_H__ */
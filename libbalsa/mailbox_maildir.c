@@ -883,18 +883,24 @@ lbm_maildir_add_message(LibBalsaMailboxLocal * local,
     fd = libbalsa_mailbox_maildir_open_temp(path, &tmp);
     if (fd == -1)
 	return FALSE;
-    out_stream = g_mime_stream_fs_new(fd);
-
-    in_stream = g_mime_stream_filter_new(stream);
-    crlffilter = g_mime_filter_dos2unix_new(FALSE);
-    g_mime_stream_filter_add(GMIME_STREAM_FILTER(in_stream), crlffilter);
-    g_object_unref(crlffilter);
- 
-    libbalsa_mime_stream_shared_lock(stream);
-    retval = g_mime_stream_write_to_stream(in_stream, out_stream);
-    libbalsa_mime_stream_shared_unlock(stream);
-    g_object_unref(in_stream);
-    g_object_unref(out_stream);
+
+    if (libbalsa_mailbox_local_clone_message(stream, fd)) {
+        close(fd);
+        retval = 0;
+    } else {
+        out_stream = g_mime_stream_fs_new(fd);
+
+        in_stream = g_mime_stream_filter_new(stream);
+        crlffilter = g_mime_filter_dos2unix_new(FALSE);
+        g_mime_stream_filter_add(GMIME_STREAM_FILTER(in_stream), crlffilter);
+        g_object_unref(crlffilter);
+
+        libbalsa_mime_stream_shared_lock(stream);
+        retval = g_mime_stream_write_to_stream(in_stream, out_stream);
+        libbalsa_mime_stream_shared_unlock(stream);
+        g_object_unref(in_stream);
+        g_object_unref(out_stream);
+    }
 
     if (retval < 0) {
 	unlink (tmp);
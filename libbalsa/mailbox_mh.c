@@ -1067,28 +1067,33 @@ lbm_mh_add_message(LibBalsaMailboxLocal * local,
 	g_free(name_used);
 	return FALSE;
     }
-    out_stream = g_mime_stream_fs_new(fd);
 
-    crlffilter = g_mime_filter_dos2unix_new(FALSE);
-    in_stream = g_mime_stream_filter_new(stream);
-    g_mime_stream_filter_add(GMIME_STREAM_FILTER(in_stream), crlffilter);
-    g_object_unref(crlffilter);
-
-    libbalsa_mime_stream_shared_lock(stream);
-    if (g_mime_stream_write_to_stream(in_stream, out_stream) == -1) {
+    if (libbalsa_mailbox_local_clone_message(stream, fd)) {
+        close(fd);
+    } else {
+        out_stream = g_mime_stream_fs_new(fd);
+
+        crlffilter = g_mime_filter_dos2unix_new(FALSE);
+        in_stream = g_mime_stream_filter_new(stream);
+        g_mime_stream_filter_add(GMIME_STREAM_FILTER(in_stream), crlffilter);
+        g_object_unref(crlffilter);
+
+        libbalsa_mime_stream_shared_lock(stream);
+        if (g_mime_stream_write_to_stream(in_stream, out_stream) == -1) {
+            libbalsa_mime_stream_shared_unlock(stream);
+            g_object_unref(in_stream);
+            g_object_unref(out_stream);
+            g_set_error(err, LIBBALSA_MAILBOX_ERROR,
+                        LIBBALSA_MAILBOX_APPEND_ERROR,
+                        _("Data copy error"));
+            unlink(name_used);
+            g_free(name_used);
+            return FALSE;
+        }
+        g_object_unref(out_stream);
         libbalsa_mime_stream_shared_unlock(stream);
         g_object_unref(in_stream);
-	g_object_unref(out_stream);
-        g_set_error(err, LIBBALSA_MAILBOX_ERROR,
-                    LIBBALSA_MAILBOX_APPEND_ERROR,
-                    _("Data copy error"));
-	unlink(name_used);
-	g_free(name_used);
-	return FALSE;
     }
-    g_object_unref(out_stream);
-    libbalsa_mime_stream_shared_unlock(stream);
-    g_object_unref(in_stream);
 
     fileno = mh->last_fileno; 
     retries = 10;
@@ -34,6 +34,7 @@
 #include "misc.h"
 #include "mailbox.h"
 #include "mailbox_pop3.h"
+#include "pop3-uids.h"
 #include <glib/gi18n.h>
 #include <glib/gstdio.h>
 
@@ -147,102 +148,29 @@ libbalsa_mailbox_pop3_open(LibBalsaMailbox * mailbox, GError **err)
 }
 
 
-#define POP_UID_FILE	"pop-uids"
-static GMutex uid_mutex;
-
-
+/* The UID lists are kept in Balsa's state directory, see pop3-uids.c. */
 static GHashTable *
 mp_load_uids(const gchar *prefix)
 {
 	GHashTable *res;
-	gboolean read_res;
-	gchar *fname;
-	gchar *contents;
-
-	res = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
-
-	fname = g_build_filename(g_get_user_state_dir(), "balsa", POP_UID_FILE, NULL);
-	g_mutex_lock(&uid_mutex);
-	read_res = g_file_get_contents(fname, &contents, NULL, NULL);
-	g_mutex_unlock(&uid_mutex);
-	g_free(fname);
-
-	if (read_res) {
-		gchar **lines;
-		size_t prefix_len;
-		guint n;
-
-		lines = g_strsplit(contents, "\n", -1);
-		g_free(contents);
-		prefix_len = strlen(prefix);
-		for (n = 0; lines[n] != NULL; n++) {
-			if (strncmp(lines[n], prefix, prefix_len) == 0) {
-				g_hash_table_insert(res, g_strdup(lines[n]), GINT_TO_POINTER(1));
-			}
-		}
-
-		g_strfreev(lines);
-	}
+	gchar *state_dir;
 
+	state_dir = g_build_filename(g_get_user_state_dir(), "balsa", NULL);
+	res = libbalsa_pop3_uids_load(state_dir, prefix);
+	g_free(state_dir);
 	return res;
 }
 
 
-static void
-mp_save_uid(gpointer key, gpointer G_GNUC_UNUSED value, gpointer user_data)
-{
-	FILE *out = (FILE *) user_data;
-
-	fputs((const gchar *) key, out);
-	fputc('\n', out);
-}
-
-
 static gboolean
 mp_save_uids(GHashTable *uids, const gchar *prefix, GError **error)
 {
-	gchar *fname;
-	gboolean read_res;
-	gchar *contents = NULL;
-	FILE *out;
+	gchar *state_dir;
 	gboolean result;
 
-	fname = g_build_filename(g_get_user_state_dir(), "balsa", POP_UID_FILE, NULL);
-
-	g_mutex_lock(&uid_mutex);
-	read_res = g_file_get_contents(fname, &contents, NULL, NULL);
-	out = fopen(fname, "w");
-	g_free(fname);
-	if (out != NULL) {
-		if (read_res) {
-			gchar **lines;
-			size_t prefix_len;
-			guint n;
-
-			lines = g_strsplit(contents, "\n", -1);
-			g_free(contents);
-			prefix_len = strlen(prefix);
-			for (n = 0; lines[n] != NULL; n++) {
-				if ((lines[n][0] != '\0') && (strncmp(lines[n], prefix, prefix_len) != 0)) {
-					fputs(lines[n], out);
-					fputc('\n', out);
-				}
-			}
-
-			g_strfreev(lines);
-		}
-
-		if (uids != NULL) {
-			g_hash_table_foreach(uids, mp_save_uid, out);
-		}
-		fclose(out);
-		result = TRUE;
-	} else {
-		g_set_error(error, MBOX_POP3_ERROR, errno, _("Saving the POP3 message UID list failed: %s"), g_strerror(errno));
-		result = FALSE;
-	}
-
-	g_mutex_unlock(&uid_mutex);
+	state_dir = g_build_filename(g_get_user_state_dir(), "balsa", NULL);
+	result = libbalsa_pop3_uids_save(state_dir, prefix, uids, error);
+	g_free(state_dir);
 	return result;
 }
 
@@ -267,6 +195,7 @@ typedef struct {
 
 static pop_handler_t *
 pop_handler_new(const gchar *filter_path,
+				gsize        size_hint,
 				GError     **error)
 {
 	pop_handler_t *res;
@@ -283,7 +212,8 @@ pop_handler_new(const gchar *filter_path,
 			res->path = g_strdup(filter_path);
 		}
 	} else {
-		res->mbx_stream = g_mime_stream_mem_new();
+		/* pre-allocate the buffer to avoid re-allocations while the message data is written in large chunks */
+		res->mbx_stream = g_mime_stream_mem_new_with_byte_array(g_byte_array_sized_new(size_hint));
 	}
 
 	return res;
@@ -379,7 +309,7 @@ message_cb(const gchar                    *buffer,
 	if (count > 0) {
 		/* message data chunk - initialise for a new message if the output does not exist */
 		if (fd->handler == NULL) {
-			fd->handler = pop_handler_new(fd->filter_path, error);
+			fd->handler = pop_handler_new(fd->filter_path, info->size, error);
 
 			if (fd->handler == NULL) {
 				result = FALSE;
@@ -514,6 +444,8 @@ libbalsa_mailbox_pop3_startup(LibBalsaServer      *server,
 		return NULL;
 	}
 
+	g_debug("POP3 mailbox %s: pipelining %s", name, net_client_pop_can_pipelining(pop) ? "active" : "inactive");
+
 	/* load message list */
 	libbalsa_mailbox_progress_notify(mailbox, LIBBALSA_NTFY_UPDATE, INFINITY, _("List messages…"));
 	if (!net_client_pop_list(pop, msg_list, !mailbox_pop3->delete_from_server, &error)) {
@@ -536,16 +468,16 @@ update_msg_list(struct fetch_data   *fd,
                 GList               *msg_list)
 {
 	GHashTable *uids = NULL;
-	gchar *uid_prefix = NULL;
-	size_t prefix_len = 0U;
 	GList *p;
 
 	/* load uid's if messages shall be left on the server */
 	if (!mailbox_pop3->delete_from_server) {
+		gchar *uid_prefix;
+
 		uid_prefix = g_strconcat(libbalsa_server_get_user(server), "@",
                                          libbalsa_server_get_host(server), NULL);
-		prefix_len = strlen(uid_prefix);
 		uids = mp_load_uids(uid_prefix);
+		g_free(uid_prefix);
 		*current_uids = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 	}
 
@@ -572,10 +504,8 @@ update_msg_list(struct fetch_data   *fd,
 
 		/* check if we already know this message */
 		if (!skip && !mailbox_pop3->delete_from_server) {
-			gchar *full_uid = g_strconcat(uid_prefix, " ", msg_info->uid, NULL);
-
-			g_hash_table_insert(*current_uids, full_uid, GINT_TO_POINTER(1));
-			if (g_hash_table_lookup(uids, full_uid) != NULL) {
+			g_hash_table_add(*current_uids, g_strdup(msg_info->uid));
+			if (g_hash_table_contains(uids, msg_info->uid)) {
 				skip = TRUE;
 			}
 		}
@@ -591,21 +521,6 @@ update_msg_list(struct fetch_data   *fd,
 		p = next;
 	}
 
-	/* copy all keys /not/ starting with the prefix from the old to the current hash table, and drop the old table */
-	if (!mailbox_pop3->delete_from_server && (msg_list != NULL)) {
-		GHashTableIter iter;
-		gpointer key;
-
-		g_hash_table_iter_init(&iter, uids);
-                g_assert(uid_prefix != NULL);  /* Avoid a false positive in scan-build */
-		while (g_hash_table_iter_next(&iter, &key, NULL)) {
-			if (strncmp((const char *) key, uid_prefix, prefix_len) != 0) {
-				g_hash_table_insert(*current_uids, key, GINT_TO_POINTER(1));
-			}
-		}
-	}
-
-	g_free(uid_prefix);
 	if (uids != NULL) {
 		g_hash_table_destroy(uids);
 	}
@@ -29,6 +29,7 @@
 #include "libbalsa.h"
 #include "misc.h"
 #include "html.h"
+#include "url-scanner.h"
 #include <glib/gi18n.h>
 
 /* FIXME: The content of this file could go to message.c */
@@ -520,10 +521,8 @@ get_line(GtkTextBuffer * buffer, GtkTextIter * iter)
  * num_paras < 0, process the whole buffer. */
 
 /* Forward references: */
-static gboolean prescanner(const gchar * p, guint len);
 static void mark_urls(GtkTextBuffer * buffer, GtkTextIter * iter,
                       GtkTextTag * tag, const gchar * p);
-static GRegex *get_url_reg(void);
 
 void
 libbalsa_unwrap_buffer(GtkTextBuffer * buffer, GtkTextIter * iter,
@@ -584,8 +583,7 @@ libbalsa_unwrap_buffer(GtkTextBuffer * buffer, GtkTextIter * iter,
 	}
 
 	line = get_line(buffer, &start);
-	if (prescanner(line, strlen(line)))
-	    mark_urls(buffer, &start, url_tag, line);
+	mark_urls(buffer, &start, url_tag, line);
 	g_free(line);
     }
 }
@@ -597,28 +595,20 @@ mark_urls(GtkTextBuffer * buffer, GtkTextIter * iter, GtkTextTag * tag,
 {
     const gchar *p = line;
     const gchar * const line_end = line + strlen(line);
-    GRegex *url_reg = get_url_reg();
-    GMatchInfo *url_match;
     GtkTextIter start = *iter;
     GtkTextIter end = *iter;
+    gint start_pos, end_pos;
 
-    while (g_regex_match(url_reg, p, 0, &url_match)) {
-        gint start_pos, end_pos;
+    while (libbalsa_find_url(p, line_end, &start_pos, &end_pos)) {
+        glong offset = g_utf8_pointer_to_offset(line, p + start_pos);
 
-        if (g_match_info_fetch_pos(url_match, 0, &start_pos, &end_pos)) {
-            glong offset = g_utf8_pointer_to_offset(line, p + start_pos);
-            gtk_text_iter_set_line_offset(&start, offset);
-            offset = g_utf8_pointer_to_offset(line, p + end_pos);
-            gtk_text_iter_set_line_offset(&end, offset);
-            gtk_text_buffer_apply_tag(buffer, tag, &start, &end);
+        gtk_text_iter_set_line_offset(&start, offset);
+        offset = g_utf8_pointer_to_offset(line, p + end_pos);
+        gtk_text_iter_set_line_offset(&end, offset);
+        gtk_text_buffer_apply_tag(buffer, tag, &start, &end);
 
-            p += end_pos;
-        }
-        if (!prescanner(p, line_end - p))
-            break;
-        g_match_info_free(url_match);
+        p += end_pos;
     }
-    g_match_info_free(url_match);
 }
 
 /*
@@ -626,56 +616,6 @@ mark_urls(GtkTextBuffer * buffer, GtkTextIter * iter, GtkTextTag * tag,
  */
 
 
-/* libbalsa_insert_with_url:
- * do a gtk_text_buffer_insert, but mark URL's with balsa_app.url_color
- *
- * prescanner: 
- * used to find candidates for lines containing URL's.
- * Empirially, this approach is faster (by factor of 8) than scanning
- * entire message with regexec. YMMV.
- * s - is the line to scan. 
- * returns TRUE if the line may contain an URL.
- */
-static gboolean
-prescanner(const gchar * s, guint len)
-{
-    gint left = len - 5;
-
-    while (--left > 0) {
-        switch (tolower(*s++)) {
-        case 'f':              /* ftp:/, ftps: */
-            if (tolower(*s) == 't' &&
-                tolower(*(s + 1)) == 'p' &&
-                (*(s + 2) == ':' || tolower(*(s + 2)) == 's') &&
-                (*(s + 3) == ':' || *(s + 3) == '/'))
-                return TRUE;
-            break;
-        case 'h':              /* http:, https */
-            if (tolower(*s) == 't' &&
-                tolower(*(s + 1)) == 't' &&
-                tolower(*(s + 2)) == 'p' &&
-                (*(s + 3) == ':' || tolower(*(s + 3)) == 's'))
-                return TRUE;
-            break;
-        case 'm':              /* mailt */
-            if (tolower(*s) == 'a' &&
-                tolower(*(s + 1)) == 'i' &&
-                tolower(*(s + 2)) == 'l' && tolower(*(s + 3)) == 't')
-                return TRUE;
-            break;
-        case 'n':              /* news:, nntp: */
-            if ((tolower(*s) == 'e' || tolower(*s) == 'n') &&
-                (tolower(*(s + 1)) == 'w' || tolower(*(s + 1)) == 't') &&
-                (tolower(*(s + 2)) == 's' || tolower(*(s + 2)) == 'p') &&
-                *(s + 3) == ':')
-                return TRUE;
-            break;
-        }
-    }
-
-    return FALSE;
-}
-
 struct url_regex_info {
     GRegex *url_reg;
     const gchar *str;
@@ -699,23 +639,6 @@ get_url_helper(struct url_regex_info *info)
     return info->url_reg;
 }
 
-static GRegex *
-get_url_reg(void)
-{
-    static struct url_regex_info info = {
-        NULL,
-        "(((https?|ftps?|nntp)://)|(mailto:|news:))"
-            "(%[0-9A-F]{2}|[-_.!~*';/?:@&=+$,#[:alnum:]])+"
-            /* do not include a trailing period or comma as part of the match;
-             * it is more likely to be punctuation than part of a URL */
-            "(%[0-9A-F]{2}|[-_!~*';/?:@&=+$#[:alnum:]])",
-        __func__,
-        "url regex compilation failed"
-    };
-
-    return get_url_helper(&info);
-}
-
 static GRegex *
 get_ml_url_reg(void)
 {
@@ -745,25 +668,124 @@ get_ml_flowed_url_reg(void)
     return get_url_helper(&info);
 }
 
+/* Text batches: libbalsa_insert_with_url used to insert every chunk
+ * of a line directly into the GtkTextBuffer, and each insert
+ * invalidates the buffer's iterators and queues relayout work.  The
+ * text and its tag spans are now collected first, and inserted with
+ * a single insert and one pass of gtk_text_buffer_apply_tag. */
+
+void
+libbalsa_text_batch_init(LibBalsaTextBatch * batch)
+{
+    batch->text = g_string_new(NULL);
+    batch->n_chars = 0;
+    batch->spans = g_array_new(FALSE, FALSE, sizeof(LibBalsaTextSpan));
+}
+
+static void
+lbtb_append(LibBalsaTextBatch * batch, const gchar * chars, gssize len,
+            GtkTextTag * tag, GtkTextTag * tag2, gchar * url,
+            guint url_len)
+{
+    gint start = batch->n_chars;
+
+    if (len < 0)
+        len = strlen(chars);
+    g_string_append_len(batch->text, chars, len);
+    batch->n_chars += g_utf8_strlen(chars, len);
+
+    if (tag == NULL && tag2 == NULL && url == NULL)
+        return;
+
+    if (url == NULL && batch->spans->len > 0) {
+        LibBalsaTextSpan *last =
+            &g_array_index(batch->spans, LibBalsaTextSpan,
+                           batch->spans->len - 1);
+
+        /* extend the previous span if it has the same tags */
+        if (last->end == start && last->url == NULL
+            && last->tag == tag && last->tag2 == tag2) {
+            last->end = batch->n_chars;
+            return;
+        }
+    }
+
+    {
+        LibBalsaTextSpan span;
+
+        span.start = start;
+        span.end = batch->n_chars;
+        span.tag = tag;
+        span.tag2 = tag2;
+        span.url = url;
+        span.url_len = url_len;
+        g_array_append_val(batch->spans, span);
+    }
+}
+
+void
+libbalsa_text_batch_append(LibBalsaTextBatch * batch, const gchar * chars,
+                           gssize len, GtkTextTag * tag, GtkTextTag * tag2)
+{
+    lbtb_append(batch, chars, len, tag, tag2, NULL, 0);
+}
+
+/* Insert the batch at the cursor, apply its tags, and pass the URLs to
+ * the url_info callback; the batch's resources are released. */
+void
+libbalsa_text_batch_apply(LibBalsaTextBatch * batch,
+                          GtkTextBuffer * buffer,
+                          LibBalsaUrlInsertInfo * url_info)
+{
+    GtkTextIter iter;
+    gint offset;
+    guint i;
+
+    gtk_text_buffer_get_iter_at_mark(buffer, &iter,
+                                     gtk_text_buffer_get_insert(buffer));
+    offset = gtk_text_iter_get_offset(&iter);
+    gtk_text_buffer_insert(buffer, &iter, batch->text->str,
+                           batch->text->len);
+
+    for (i = 0; i < batch->spans->len; i++) {
+        LibBalsaTextSpan *span =
+            &g_array_index(batch->spans, LibBalsaTextSpan, i);
+        GtkTextIter start, end;
+
+        gtk_text_buffer_get_iter_at_offset(buffer, &start,
+                                           offset + span->start);
+        end = start;
+        gtk_text_iter_forward_chars(&end, span->end - span->start);
+        if (span->tag != NULL)
+            gtk_text_buffer_apply_tag(buffer, span->tag, &start, &end);
+        if (span->tag2 != NULL)
+            gtk_text_buffer_apply_tag(buffer, span->tag2, &start, &end);
+        if (span->url != NULL) {
+            if (url_info != NULL)
+                url_info->callback(buffer, &end, span->url, span->url_len,
+                                   url_info->callback_data);
+            g_free(span->url);
+        }
+    }
+
+    g_string_free(batch->text, TRUE);
+    batch->text = NULL;
+    g_array_free(batch->spans, TRUE);
+    batch->spans = NULL;
+    batch->n_chars = 0;
+}
+
 gboolean
-libbalsa_insert_with_url(GtkTextBuffer * buffer,
+libbalsa_insert_with_url(LibBalsaTextBatch * batch,
                          const char *chars,
                          guint len,
                          GtkTextTag * tag,
                          LibBalsaUrlInsertInfo *url_info)
 {
-    GtkTextIter iter;
-    GtkTextTagTable *table = gtk_text_buffer_get_tag_table(buffer);
-    GtkTextTag *url_tag = gtk_text_tag_table_lookup(table, "url");
-    gboolean match;
+    GtkTextTag *url_tag = url_info->url_tag;
     gint start_pos, end_pos;
-    GRegex *url_reg;
-    GMatchInfo *url_match;
     const gchar * const line_end = chars + len;
 
-    gtk_text_buffer_get_iter_at_mark(buffer, &iter,
-                                     gtk_text_buffer_get_insert(buffer));
-
     if (url_info->ml_url_buffer) {
         const gchar *url_end;
         gchar *url, *q, *r;
@@ -777,39 +799,22 @@ libbalsa_insert_with_url(GtkTextBuffer * buffer,
 
         g_string_append_len(url_info->ml_url_buffer, chars,
                             url_end - chars);
-        gtk_text_buffer_insert_with_tags(buffer, &iter,
-                                         url_info->ml_url_buffer->str,
-                                         url_info->ml_url_buffer->len,
-                                         url_tag, tag, NULL);
         q = url = g_new(gchar, url_info->ml_url_buffer->len);
         for (r = url_info->ml_url_buffer->str; *r; r++)
             if (*r > ' ')
                 *q++ = *r;
-        url_info->callback(buffer, &iter, url, q - url,
-                           url_info->callback_data);
-        g_free(url);
+        lbtb_append(batch, url_info->ml_url_buffer->str,
+                    url_info->ml_url_buffer->len, url_tag, tag,
+                    url, q - url);
         g_string_free(url_info->ml_url_buffer, TRUE);
         url_info->ml_url_buffer = NULL;
         chars = url_end;
     }
 
-    if (!prescanner(chars, line_end - chars)) {
-        gtk_text_buffer_insert_with_tags(buffer, &iter, chars,
-                                         line_end - chars, tag, NULL);
-        return FALSE;
-    }
-
-    url_reg = get_url_reg();
-    match = g_regex_match(url_reg, chars, 0, &url_match)
-        && g_match_info_fetch_pos(url_match, 0, &start_pos, &end_pos)
-        && chars + start_pos < line_end;
-    g_match_info_free(url_match);
-
-    while (match) {
+    while (libbalsa_find_url(chars, line_end, &start_pos, &end_pos)) {
         const gchar *spc;
 
-        gtk_text_buffer_insert_with_tags(buffer, &iter, chars,
-                                         start_pos, tag, NULL);
+        lbtb_append(batch, chars, start_pos, tag, NULL, NULL, 0);
 
         /* check if we hit a multi-line URL... (see RFC 1738) */
         if ((start_pos > 0 && (chars[start_pos - 1] == '<')) ||
@@ -851,6 +856,7 @@ libbalsa_insert_with_url(GtkTextBuffer * buffer,
             GString *uri_real = g_string_new("");
             gchar *q, *buf;
             gchar *buf_spc;
+            guint uri_len;
 
             q = buf = g_strndup(chars + start_pos, end_pos - start_pos);
             buf_spc = buf + (spc - (chars + start_pos));
@@ -860,39 +866,22 @@ libbalsa_insert_with_url(GtkTextBuffer * buffer,
                 q = buf_spc + 1;
             } while ((buf_spc = strchr(q, ' ')));
             g_string_append(uri_real, q);
-            gtk_text_buffer_insert_with_tags(buffer, &iter, buf, -1,
-                                             url_tag, tag, NULL);
+            uri_len = uri_real->len;
+            lbtb_append(batch, buf, -1, url_tag, tag,
+                        g_string_free(uri_real, FALSE), uri_len);
             g_free(buf);
-            url_info->callback(buffer, &iter,
-                               uri_real->str, uri_real->len,
-                               url_info->callback_data);
-            g_string_free(uri_real, TRUE);
         } else {
-            gtk_text_buffer_insert_with_tags(buffer, &iter,
-                                             chars + start_pos,
-                                             end_pos - start_pos,
-                                             url_tag, tag, NULL);
-
             /* remember the URL and its position within the text */
-            url_info->callback(buffer, &iter, chars + start_pos,
-                               end_pos - start_pos,
-                               url_info->callback_data);
+            lbtb_append(batch, chars + start_pos, end_pos - start_pos,
+                        url_tag, tag,
+                        g_strndup(chars + start_pos, end_pos - start_pos),
+                        end_pos - start_pos);
         }
 
         chars += end_pos;
-        if (prescanner(chars, line_end - chars)) {
-            match = g_regex_match(url_reg, chars, 0, &url_match)
-                && g_match_info_fetch_pos(url_match, 0, &start_pos,
-                                          &end_pos)
-                && chars + start_pos < line_end;
-            g_match_info_free(url_match);
-        } else {
-            match = FALSE;
-        }
     }
 
-    gtk_text_buffer_insert_with_tags(buffer, &iter, chars,
-                                     line_end - chars, tag, NULL);
+    lbtb_append(batch, chars, line_end - chars, tag, NULL, NULL, 0);
 
     return FALSE;
 }
@@ -972,6 +961,16 @@ libbalsa_unwrap_selection(GtkTextBuffer * buffer, GRegex * rex)
 gboolean
 libbalsa_match_regex(const gchar * line, GRegex * rex, guint * count,
                      guint * index)
+{
+    return libbalsa_match_regex_len(line, strlen(line), rex, count, index);
+}
+
+/* As libbalsa_match_regex, but only the first len bytes of line are
+ * scanned, so line may point into a larger buffer, e.g. a complete
+ * message body, without its remainder being measured on every match. */
+gboolean
+libbalsa_match_regex_len(const gchar * line, gsize len, GRegex * rex,
+                         guint * count, guint * index)
 {
     GMatchInfo *rm;
     gint c;
@@ -980,7 +979,7 @@ libbalsa_match_regex(const gchar * line, GRegex * rex, guint * count,
 
     c = 0;
     for (p = line;
-         g_regex_match(rex, p, 0, &rm)
+         g_regex_match_full(rex, p, len - (p - line), 0, 0, &rm, NULL)
          && g_match_info_fetch_pos(rm, 0, NULL, &end_pos)
          && end_pos > 0;
          p += end_pos) {
@@ -1002,13 +1001,12 @@ libbalsa_html_encode_hyperlinks(GString * paragraph)
 {
     GString * retval;
     gchar * p;
-    GRegex *url_reg = get_url_reg();
-    GMatchInfo *url_match;
-    gboolean match;
+    const gchar * const text_end = paragraph->str + paragraph->len;
+    gint start_pos, end_pos;
     gchar * markup;
 
     /* check for any url */
-    if (!prescanner(paragraph->str, paragraph->len)) {
+    if (!libbalsa_find_url(paragraph->str, text_end, &start_pos, &end_pos)) {
         markup = g_markup_escape_text(paragraph->str, -1);
         g_string_assign(paragraph, markup);
         g_free(markup);
@@ -1019,14 +1017,7 @@ libbalsa_html_encode_hyperlinks(GString * paragraph)
     retval = g_string_new("");
     p = paragraph->str;
 
-    match = g_regex_match(url_reg, p, 0, &url_match);
-
-    while (match) {
-        gint start_pos, end_pos;
-
-        if (!g_match_info_fetch_pos(url_match, 0, &start_pos, &end_pos))
-            break;
-
+    do {
         /* add the url to the result */
         if (start_pos > 0) {
             markup = g_markup_escape_text(p, start_pos);
@@ -1041,13 +1032,7 @@ libbalsa_html_encode_hyperlinks(GString * paragraph)
 
         /* find next (if any) */
         p += end_pos;
-        if (prescanner(p, paragraph->len - (p - paragraph->str))) {
-            g_match_info_free(url_match);
-            match = g_regex_match(url_reg, p, 0, &url_match);
-        } else
-            match = FALSE;
-    }
-    g_match_info_free(url_match);
+    } while (libbalsa_find_url(p, text_end, &start_pos, &end_pos));
 
     /* copy remainder */
     if (*p != '\0') {
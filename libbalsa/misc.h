@@ -82,6 +82,27 @@ struct _LibBalsaUrlInsertInfo {
     gpointer callback_data;
     gboolean buffer_is_flowed;
     GString *ml_url_buffer;
+    GtkTextTag *url_tag;
+};
+
+/* Text collected for a GtkTextBuffer, inserted in a single operation by
+ * libbalsa_text_batch_apply(); offsets are in characters, relative to
+ * the start of the batch. */
+typedef struct _LibBalsaTextSpan LibBalsaTextSpan;
+struct _LibBalsaTextSpan {
+    gint start;
+    gint end;
+    GtkTextTag *tag;
+    GtkTextTag *tag2;
+    gchar *url;                 /* non-NULL for the span of an URL */
+    guint url_len;
+};
+
+typedef struct _LibBalsaTextBatch LibBalsaTextBatch;
+struct _LibBalsaTextBatch {
+    GString *text;
+    gint n_chars;
+    GArray *spans;              /* of LibBalsaTextSpan, sorted by start */
 };
 
 #define LIBBALSA_ERROR_QUARK (g_quark_from_static_string("libbalsa"))
@@ -117,7 +138,14 @@ LibBalsaCodeset libbalsa_set_fallback_codeset(LibBalsaCodeset codeset);
 gboolean libbalsa_utf8_sanitize(gchar ** text, gboolean fallback,
                                 gchar const **target);
 gboolean libbalsa_utf8_strstr(const gchar *s1,const gchar *s2);
-gboolean libbalsa_insert_with_url(GtkTextBuffer * buffer,
+void libbalsa_text_batch_init(LibBalsaTextBatch * batch);
+void libbalsa_text_batch_append(LibBalsaTextBatch * batch,
+                                const gchar * chars, gssize len,
+                                GtkTextTag * tag, GtkTextTag * tag2);
+void libbalsa_text_batch_apply(LibBalsaTextBatch * batch,
+                               GtkTextBuffer * buffer,
+                               LibBalsaUrlInsertInfo * url_info);
+gboolean libbalsa_insert_with_url(LibBalsaTextBatch * batch,
 				  const char *chars,
 				  guint len,
 				  GtkTextTag * tag,
@@ -125,6 +153,9 @@ gboolean libbalsa_insert_with_url(GtkTextBuffer * buffer,
 void libbalsa_unwrap_selection(GtkTextBuffer * buffer, GRegex * rex);
 gboolean libbalsa_match_regex(const gchar * line, GRegex * rex,
 			      guint * count, guint * index);
+gboolean libbalsa_match_regex_len(const gchar * line, gsize len,
+                                  GRegex * rex, guint * count,
+                                  guint * index);
 
 int libbalsa_lock_file (const char *path, int fd, int excl, int dot, int timeout);
 int libbalsa_unlock_file (const char *path, int fd, int dot);
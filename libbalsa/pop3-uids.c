@@ -0,0 +1,147 @@
+/* -*-mode:c; c-style:k&r; c-basic-offset:4; -*- */
+/* Balsa E-Mail Client
+ *
+ * Copyright (C) 1997-2019 Stuart Parmenter and others,
+ *                         See the file AUTHORS for a list.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option) 
+ * any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the  
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* The POP3 UID list depends only on GLib, so that pop3_uids_tst can be
+ * built without the rest of libbalsa. */
+#if defined(HAVE_CONFIG_H) && HAVE_CONFIG_H
+# include "config.h"
+#endif                          /* HAVE_CONFIG_H */
+#include "pop3-uids.h"
+
+#include <errno.h>
+#include <string.h>
+#include <glib/gi18n.h>
+#include <glib/gstdio.h>
+
+#define MBOX_POP3_ERROR 	(g_quark_from_static_string("mailbox-pop3"))
+
+
+/* The UIDs of the messages left on the server are stored in one file per
+ * account (user@host) in POP_UID_DIR, one UID per line.  The file is
+ * replaced atomically when it is saved.  POP_UID_FILE is the file used by
+ * older versions for all accounts, with lines "user@host uid"; it is read
+ * only if an account does not have its own file yet.  Both are located in
+ * the state directory passed by the caller. */
+#define POP_UID_DIR		"pop-uids.d"
+#define POP_UID_FILE	"pop-uids"
+
+
+static gchar *
+uid_file_name(const gchar *state_dir, const gchar *account)
+{
+	gchar *escaped;
+	gchar *fname;
+
+	escaped = g_uri_escape_string(account, "@", FALSE);
+	fname = g_build_filename(state_dir, POP_UID_DIR, escaped, NULL);
+	g_free(escaped);
+	return fname;
+}
+
+
+GHashTable *
+libbalsa_pop3_uids_load(const gchar *state_dir, const gchar *account)
+{
+	GHashTable *res;
+	gchar *fname;
+	gchar *contents;
+	gboolean legacy = FALSE;
+
+	res = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+	fname = uid_file_name(state_dir, account);
+	if (!g_file_get_contents(fname, &contents, NULL, NULL)) {
+		g_free(fname);
+		fname = g_build_filename(state_dir, POP_UID_FILE, NULL);
+		legacy = g_file_get_contents(fname, &contents, NULL, NULL);
+		if (!legacy) {
+			contents = NULL;
+		}
+	}
+	g_free(fname);
+
+	if (contents != NULL) {
+		gchar *line;
+		gchar *next;
+		size_t account_len;
+
+		account_len = strlen(account);
+		for (line = contents; *line != '\0'; line = next) {
+			next = strchr(line, '\n');
+			if (next != NULL) {
+				*next++ = '\0';
+			} else {
+				next = line + strlen(line);
+			}
+
+			if (legacy) {
+				if ((strncmp(line, account, account_len) == 0) && (line[account_len] == ' ')) {
+					g_hash_table_add(res, g_strdup(&line[account_len + 1U]));
+				}
+			} else if (*line != '\0') {
+				g_hash_table_add(res, g_strdup(line));
+			}
+		}
+		g_free(contents);
+	}
+
+	return res;
+}
+
+
+gboolean
+libbalsa_pop3_uids_save(const gchar *state_dir, const gchar *account, GHashTable *uids, GError **error)
+{
+	gchar *fname;
+	gchar *dirname;
+	GString *contents;
+	GHashTableIter iter;
+	gpointer key;
+	GError *local_err = NULL;
+	gboolean result;
+
+	contents = g_string_new(NULL);
+	if (uids != NULL) {
+		g_hash_table_iter_init(&iter, uids);
+		while (g_hash_table_iter_next(&iter, &key, NULL)) {
+			g_string_append(contents, (const gchar *) key);
+			g_string_append_c(contents, '\n');
+		}
+	}
+
+	fname = uid_file_name(state_dir, account);
+	dirname = g_path_get_dirname(fname);
+	if (g_mkdir_with_parents(dirname, 0700) != 0) {
+		g_set_error(error, MBOX_POP3_ERROR, errno, _("Saving the POP3 message UID list failed: %s"), g_strerror(errno));
+		result = FALSE;
+	} else if (!g_file_set_contents(fname, contents->str, contents->len, &local_err)) {
+		g_set_error(error, MBOX_POP3_ERROR, local_err->code, _("Saving the POP3 message UID list failed: %s"),
+			local_err->message);
+		g_error_free(local_err);
+		result = FALSE;
+	} else {
+		result = TRUE;
+	}
+	g_free(dirname);
+	g_free(fname);
+	g_string_free(contents, TRUE);
+
+	return result;
+}
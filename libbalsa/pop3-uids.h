@@ -0,0 +1,29 @@
+/* -*-mode:c; c-style:k&r; c-basic-offset:4; -*- */
+/* Balsa E-Mail Client
+ *
+ * Copyright (C) 1997-2019 Stuart Parmenter and others,
+ *                         See the file AUTHORS for a list.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option) 
+ * any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the  
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __LIBBALSA_POP3_UIDS_H__
+#define __LIBBALSA_POP3_UIDS_H__
+
+#include <glib.h>
+
+GHashTable *libbalsa_pop3_uids_load(const gchar *state_dir, const gchar *account);
+gboolean libbalsa_pop3_uids_save(const gchar *state_dir, const gchar *account, GHashTable *uids, GError **error);
+
+#endif                          /* __LIBBALSA_POP3_UIDS_H__ */
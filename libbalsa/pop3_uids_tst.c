@@ -0,0 +1,249 @@
+/* -*-mode:c; c-style:k&r; c-basic-offset:4; -*- */
+/* Balsa E-Mail Client
+ *
+ * Copyright (C) 1997-2019 Stuart Parmenter and others,
+ *                         See the file AUTHORS for a list.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option) 
+ * any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the  
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* pop3_uids_tst checks the POP3 UID lists in a temporary state
+ * directory: the UIDs of an account are read from the shared legacy file
+ * until the account has saved its own file, other accounts are not
+ * affected, and a large list survives a round trip.
+ *
+ * Usage: pop3_uids_tst [COUNT]
+ */
+
+#if defined(HAVE_CONFIG_H) && HAVE_CONFIG_H
+# include "config.h"
+#endif                          /* HAVE_CONFIG_H */
+#include "pop3-uids.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <glib/gstdio.h>
+
+
+/* the legacy file shared by all accounts */
+#define LEGACY_UIDS								\
+	"alice@pop.example.com uid-1\n"				\
+	"alice@pop.example.com uid-2\n"				\
+	"alice@pop.example.comx uid-3\n"			\
+	"alice@pop.example uid-4\n"					\
+	"bob@pop.example.com uid-5\n"				\
+	"alice@pop.example.com uid-6"
+
+
+/* Compare the UIDs of account with the NULL-terminated list expected. */
+static int
+check_uids(const gchar *state_dir, const gchar *account, const gchar *const *expected)
+{
+	GHashTable *uids;
+	guint n;
+	int failure_count = 0;
+
+	uids = libbalsa_pop3_uids_load(state_dir, account);
+	for (n = 0U; expected[n] != NULL; n++) {
+		if (!g_hash_table_contains(uids, expected[n])) {
+			printf("%s: UID “%s” not found\n", account, expected[n]);
+			failure_count++;
+		}
+	}
+	if (g_hash_table_size(uids) != n) {
+		printf("%s: %u UIDs found, expected %u\n", account, g_hash_table_size(uids), n);
+		failure_count++;
+	}
+	g_hash_table_destroy(uids);
+
+	return failure_count;
+}
+
+
+static int
+save_uids(const gchar *state_dir, const gchar *account, const gchar *const *uid_list)
+{
+	GHashTable *uids;
+	GError *error = NULL;
+	guint n;
+	int failure_count = 0;
+
+	uids = g_hash_table_new(g_str_hash, g_str_equal);
+	for (n = 0U; uid_list[n] != NULL; n++) {
+		g_hash_table_add(uids, (gpointer) uid_list[n]);
+	}
+	if (!libbalsa_pop3_uids_save(state_dir, account, uids, &error)) {
+		printf("%s: %s\n", account, error->message);
+		g_error_free(error);
+		failure_count++;
+	}
+	g_hash_table_destroy(uids);
+
+	return failure_count;
+}
+
+
+static int
+test_migration(const gchar *state_dir)
+{
+	static const gchar *const none[] = { NULL };
+	static const gchar *const alice_legacy[] = { "uid-1", "uid-2", "uid-6", NULL };
+	static const gchar *const alice_new[] = { "uid-2", "uid-7", NULL };
+	static const gchar *const bob_legacy[] = { "uid-5", NULL };
+	static const gchar *const slash[] = { "uid/8", NULL };
+	gchar *legacy_file;
+	gchar *contents = NULL;
+	int failure_count = 0;
+
+	/* no files at all */
+	failure_count += check_uids(state_dir, "alice@pop.example.com", none);
+
+	legacy_file = g_build_filename(state_dir, "pop-uids", NULL);
+	if (!g_file_set_contents(legacy_file, LEGACY_UIDS, -1, NULL)) {
+		printf("cannot write %s\n", legacy_file);
+		g_free(legacy_file);
+		return 1;
+	}
+
+	/* only the lines of the exact account are read from the legacy file */
+	failure_count += check_uids(state_dir, "alice@pop.example.com", alice_legacy);
+	failure_count += check_uids(state_dir, "bob@pop.example.com", bob_legacy);
+	failure_count += check_uids(state_dir, "carol@pop.example.com", none);
+
+	/* once saved, the own file is used, and the legacy file is left alone */
+	failure_count += save_uids(state_dir, "alice@pop.example.com", alice_new);
+	failure_count += check_uids(state_dir, "alice@pop.example.com", alice_new);
+	failure_count += check_uids(state_dir, "bob@pop.example.com", bob_legacy);
+	if (!g_file_get_contents(legacy_file, &contents, NULL, NULL) || (strcmp(contents, LEGACY_UIDS) != 0)) {
+		printf("the legacy file has been changed\n");
+		failure_count++;
+	}
+	g_free(contents);
+
+	/* an empty own file hides the legacy UIDs */
+	failure_count += save_uids(state_dir, "bob@pop.example.com", none);
+	failure_count += check_uids(state_dir, "bob@pop.example.com", none);
+	failure_count += check_uids(state_dir, "alice@pop.example.com", alice_new);
+
+	/* a user name which is not a valid file name */
+	failure_count += save_uids(state_dir, "dave/../x@pop.example.com", slash);
+	failure_count += check_uids(state_dir, "dave/../x@pop.example.com", slash);
+	failure_count += check_uids(state_dir, "dave@pop.example.com", none);
+
+	g_free(legacy_file);
+
+	return failure_count;
+}
+
+
+static int
+test_large(const gchar *state_dir, guint count)
+{
+	GHashTable *uids;
+	GHashTable *loaded;
+	GHashTableIter iter;
+	gpointer key;
+	GError *error = NULL;
+	guint n;
+	int failure_count = 0;
+
+	uids = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+	for (n = 0U; n < count; n++) {
+		g_hash_table_add(uids, g_strdup_printf("%08x.%u", g_random_int(), n));
+	}
+	if (!libbalsa_pop3_uids_save(state_dir, "large@pop.example.com", uids, &error)) {
+		printf("large: %s\n", error->message);
+		g_error_free(error);
+		g_hash_table_destroy(uids);
+		return 1;
+	}
+
+	loaded = libbalsa_pop3_uids_load(state_dir, "large@pop.example.com");
+	if (g_hash_table_size(loaded) != count) {
+		printf("large: %u UIDs found, expected %u\n", g_hash_table_size(loaded), count);
+		failure_count++;
+	}
+	g_hash_table_iter_init(&iter, uids);
+	while ((failure_count == 0) && g_hash_table_iter_next(&iter, &key, NULL)) {
+		if (!g_hash_table_contains(loaded, key)) {
+			printf("large: UID “%s” not found\n", (const gchar *) key);
+			failure_count++;
+		}
+	}
+	g_hash_table_destroy(loaded);
+	g_hash_table_destroy(uids);
+
+	return failure_count;
+}
+
+
+/* Remove the temporary state directory, which contains the legacy file and
+ * the files of the accounts. */
+static void
+remove_state_dir(const gchar *state_dir)
+{
+	gchar *uid_dir;
+	GDir *dir;
+
+	uid_dir = g_build_filename(state_dir, "pop-uids.d", NULL);
+	dir = g_dir_open(uid_dir, 0, NULL);
+	if (dir != NULL) {
+		const gchar *name;
+
+		while ((name = g_dir_read_name(dir)) != NULL) {
+			gchar *fname = g_build_filename(uid_dir, name, NULL);
+
+			g_unlink(fname);
+			g_free(fname);
+		}
+		g_dir_close(dir);
+	}
+	g_rmdir(uid_dir);
+	g_free(uid_dir);
+
+	uid_dir = g_build_filename(state_dir, "pop-uids", NULL);
+	g_unlink(uid_dir);
+	g_free(uid_dir);
+	g_rmdir(state_dir);
+}
+
+
+int
+main(int argc, char *argv[])
+{
+	gchar *state_dir;
+	guint count;
+	GError *error = NULL;
+	int failure_count;
+
+	count = (argc > 1) ? (guint) strtoul(argv[1], NULL, 10) : 500000U;
+
+	state_dir = g_dir_make_tmp("pop3_uids_tst-XXXXXX", &error);
+	if (state_dir == NULL) {
+		printf("cannot create a temporary directory: %s\n", error->message);
+		g_error_free(error);
+		return 1;
+	}
+
+	failure_count = test_migration(state_dir);
+	failure_count += test_large(state_dir, count);
+	remove_state_dir(state_dir);
+	g_free(state_dir);
+
+	if (failure_count > 0) {
+		printf("%d POP3 UID list check(s) failed\n", failure_count);
+	}
+	return (failure_count > 0) ? 1 : 0;
+}
@@ -41,6 +41,7 @@
 
 #include "net-client-smtp.h"
 #include "gmime-filter-header.h"
+#include "mime-stream-shared.h"
 #include "smtp-server.h"
 #include "identity.h"
 
@@ -48,6 +49,7 @@
 #include "libbalsa-gpgme.h"
 
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 
 #ifdef G_LOG_DOMAIN
 #  undef G_LOG_DOMAIN
@@ -60,7 +62,8 @@ typedef struct _SendMessageInfo SendMessageInfo;
 struct _MessageQueueItem {
 	SendMessageInfo *smsg_info;
     LibBalsaMessage *orig;
-    GMimeStream *stream;
+    GMimeStream *stream;        /* only while the message is transmitted */
+    gint64 size;
     NetClientSmtpMessage *smtp_msg;
 };
 
@@ -232,6 +235,7 @@ static LibBalsaMsgCreateResult libbalsa_create_msg(LibBalsaMessage *message,
                                                    GError         **error);
 static LibBalsaMsgCreateResult libbalsa_fill_msg_queue_item_from_queu(LibBalsaMessage  *message,
                                                                       MessageQueueItem *mqi);
+static gboolean msg_queue_item_open_stream(MessageQueueItem *mqi);
 
 static void
 lbs_set_content(GMimePart *mime_part,
@@ -740,9 +744,10 @@ lbs_process_queue_msg(guint 		   msgno,
 		add_recipients(new_message->smtp_msg, headers->cc_list, request_dsn);
 		add_recipients(new_message->smtp_msg, headers->bcc_list, request_dsn);
 
-		/* Estimate the size of the message.  This need not be exact but it's better to err
-		 * on the large side since some message headers may be altered during the transfer. */
-		send_message_info->total_size += g_mime_stream_length(new_message->stream);
+		/* Estimate the size of the message from the stored one.  It is corrected by
+		 * msg_queue_item_open_stream(), as the data sent has CRLF line endings and
+		 * some headers removed. */
+		send_message_info->total_size += new_message->size;
 		send_message_info->msg_count++;
 	}
 	g_object_unref(msg);
@@ -1046,7 +1051,14 @@ balsa_send_message_real(SendMessageInfo *info)
             info->curr_msg++;
             g_debug("%s: %u/%u mqi = %p", __func__, info->msg_count, info->curr_msg, mqi);
             /* send the message */
-            send_res = net_client_smtp_send_msg(info->session, mqi->smtp_msg, &server_reply, &error);
+            if (msg_queue_item_open_stream(mqi)) {
+                send_res = net_client_smtp_send_msg(info->session, mqi->smtp_msg, &server_reply, &error);
+                g_clear_object(&mqi->stream);
+            } else {
+                g_set_error(&error, LIBBALSA_MAILBOX_ERROR, LIBBALSA_MAILBOX_ACCESS_ERROR,
+                            _("Cannot read the message from the outbox"));
+                send_res = FALSE;
+            }
             balsa_send_message_syslog(net_client_get_host(NET_CLIENT(info->session)), mqi, send_res, server_reply, error);
             g_free(server_reply);
 
@@ -1668,6 +1680,10 @@ libbalsa_create_msg(LibBalsaMessage *message,
 }
 
 
+/* Note: the message is not copied into memory here, as the outbox may
+ * contain huge messages.  The stored message is streamed through the
+ * SMTP filters by msg_queue_item_open_stream() when it is actually
+ * transmitted. */
 static LibBalsaMsgCreateResult
 libbalsa_fill_msg_queue_item_from_queu(LibBalsaMessage  *message,
                                        MessageQueueItem *mqi)
@@ -1675,52 +1691,96 @@ libbalsa_fill_msg_queue_item_from_queu(LibBalsaMessage  *message,
     GMimeStream *msg_stream;
     LibBalsaMsgCreateResult result = LIBBALSA_MESSAGE_CREATE_ERROR;
 
-    mqi->orig = message;
-    if (libbalsa_message_get_mime_message(message) != NULL) {
-        LibBalsaMailbox *mailbox = libbalsa_message_get_mailbox(message);
-
-        msg_stream = g_mime_stream_mem_new();
-        libbalsa_mailbox_lock_store(mailbox);
-        g_mime_object_write_to_stream(GMIME_OBJECT(libbalsa_message_get_mime_message(message)), NULL, msg_stream);
-        libbalsa_mailbox_unlock_store(mailbox);
-        g_mime_stream_reset(msg_stream);
-    } else {
-        msg_stream = libbalsa_message_stream(message);
-    }
-
+    msg_stream = libbalsa_message_stream(message);
     if (msg_stream != NULL) {
-        GMimeStream *filter_stream;
-        GMimeFilter *filter;
+        mqi->size = g_mime_stream_length(msg_stream);
+        g_object_unref(msg_stream);
+        mqi->orig = g_object_ref(message);
+        result = LIBBALSA_MESSAGE_CREATE_OK;
+    }
 
-        filter_stream = g_mime_stream_filter_new(msg_stream);
+    return result;
+}
 
-        /* filter out unwanted headers */
-        filter = g_mime_filter_header_new();
-        g_mime_stream_filter_add(GMIME_STREAM_FILTER(filter_stream), filter);
-        g_object_unref(filter);
 
-        /* add CRLF */
-        filter = g_mime_filter_unix2dos_new(FALSE);
-        g_mime_stream_filter_add(GMIME_STREAM_FILTER(filter_stream), filter);
-        g_object_unref(filter);
+/* Open the stream passed to the SMTP server for the queued message.
+ * The stored message is filtered into an unlinked temporary file while
+ * the mailbox and its stream are locked, so a concurrent sync or expunge
+ * of the outbox cannot slip in, but neither lock is held while the data
+ * is transmitted.  It must be called immediately before the
+ * transmission, as syncing the outbox after a message has been sent may
+ * move the other messages in an mbox file.  The progress estimate is
+ * corrected to the size of the filtered data. */
+static gboolean
+msg_queue_item_open_stream(MessageQueueItem *mqi)
+{
+    LibBalsaMailbox *mailbox;
+    GMimeStream *msg_stream;
+    GMimeStream *filter_stream;
+    GMimeFilter *filter;
+    gchar *tmp_name;
+    gint fd;
+    gint64 len;
+    GError *error = NULL;
 
-        /* encode dot */
-        filter = g_mime_filter_smtp_data_new();
-        g_mime_stream_filter_add(GMIME_STREAM_FILTER(filter_stream), filter);
-        g_object_unref(filter);
+    mailbox = libbalsa_message_get_mailbox(mqi->orig);
+    if (mailbox == NULL) {
+        return FALSE;
+    }
 
-        /* write to a new stream */
-        mqi->stream = g_mime_stream_mem_new();
-        g_mime_stream_write_to_stream(filter_stream, mqi->stream);
-        g_object_unref(filter_stream);
-        g_mime_stream_reset(mqi->stream);
-        g_object_unref(msg_stream);
+    fd = g_file_open_tmp("balsa-send-XXXXXX", &tmp_name, &error);
+    if (fd < 0) {
+        g_warning("%s: could not create temporary file: %s", __func__, error->message);
+        g_error_free(error);
+        return FALSE;
+    }
+    /* the file is removed as soon as the stream is closed */
+    g_unlink(tmp_name);
+    g_free(tmp_name);
+    mqi->stream = g_mime_stream_fs_new(fd);
+
+    libbalsa_lock_mailbox(mailbox);
+    msg_stream = libbalsa_message_get_msgno(mqi->orig) > 0 ?
+        libbalsa_message_stream(mqi->orig) : NULL;
+    if (msg_stream == NULL) {
+        libbalsa_unlock_mailbox(mailbox);
+        g_clear_object(&mqi->stream);
+        return FALSE;
+    }
 
-        g_object_ref(mqi->orig);
-        result = LIBBALSA_MESSAGE_CREATE_OK;
+    filter_stream = g_mime_stream_filter_new(msg_stream);
+
+    /* filter out unwanted headers */
+    filter = g_mime_filter_header_new();
+    g_mime_stream_filter_add(GMIME_STREAM_FILTER(filter_stream), filter);
+    g_object_unref(filter);
+
+    /* add CRLF */
+    filter = g_mime_filter_unix2dos_new(FALSE);
+    g_mime_stream_filter_add(GMIME_STREAM_FILTER(filter_stream), filter);
+    g_object_unref(filter);
+
+    /* encode dot */
+    filter = g_mime_filter_smtp_data_new();
+    g_mime_stream_filter_add(GMIME_STREAM_FILTER(filter_stream), filter);
+    g_object_unref(filter);
+
+    libbalsa_mime_stream_shared_lock(msg_stream);
+    len = g_mime_stream_write_to_stream(filter_stream, mqi->stream);
+    libbalsa_mime_stream_shared_unlock(msg_stream);
+    libbalsa_unlock_mailbox(mailbox);
+    g_object_unref(filter_stream);
+    g_object_unref(msg_stream);
+
+    if ((len < 0) || (g_mime_stream_flush(mqi->stream) != 0) || (g_mime_stream_reset(mqi->stream) != 0)) {
+        g_clear_object(&mqi->stream);
+        return FALSE;
     }
 
-    return result;
+    mqi->smsg_info->total_size += len - mqi->size;
+    mqi->size = len;
+
+    return TRUE;
 }
 
 
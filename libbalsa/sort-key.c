@@ -0,0 +1,82 @@
+/* -*-mode:c; c-style:k&r; c-basic-offset:4; -*- */
+/* Balsa E-Mail Client
+ *
+ * Copyright (C) 1997-2016 Stuart Parmenter and others,
+ *                         See the file AUTHORS for a list.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option) 
+ * any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the  
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* The sort keys depend only on GLib, so that sort_key_tst can be built
+ * without the rest of libbalsa. */
+#if defined(HAVE_CONFIG_H) && HAVE_CONFIG_H
+# include "config.h"
+#endif                          /* HAVE_CONFIG_H */
+#include "sort-key.h"
+
+#include <string.h>
+#include <glib/gi18n.h>
+
+/* Sort keys: the sender and subject columns are compared with the
+ * collation keys of their case-folded values, computed once when the
+ * entry is filled, so that sorting needs only strcmp. Reply and forward
+ * prefixes are not part of the subject key. */
+const gchar *
+libbalsa_chop_subject_prefixes(const gchar * subject)
+{
+    static const gchar *const prefixes[] = { "re:", "aw:", "fwd:", "fw:" };
+    const gchar *p = subject;
+
+    while (*p) {
+        gsize len = 0;
+        guint i;
+
+        while (g_ascii_isspace(*p))
+            p++;
+
+        for (i = 0; i < G_N_ELEMENTS(prefixes) && len == 0; i++)
+            if (g_ascii_strncasecmp(p, prefixes[i], strlen(prefixes[i])) == 0)
+                len = strlen(prefixes[i]);
+        if (len == 0
+            && g_ascii_strncasecmp(p, _("Re:"), strlen(_("Re:"))) == 0)
+            len = strlen(_("Re:"));
+        if (len == 0
+            && g_ascii_strncasecmp(p, _("Fwd:"), strlen(_("Fwd:"))) == 0)
+            len = strlen(_("Fwd:"));
+        if (len == 0)
+            break;
+
+        p += len;
+    }
+
+    return p;
+}
+
+gchar *
+libbalsa_sort_key(const gchar * str)
+{
+    gchar *valid;
+    gchar *folded;
+    gchar *key;
+
+    /* Replace invalid sequences, so that all keys are collation keys
+     * and compare consistently with each other. */
+    valid = g_utf8_make_valid(str != NULL ? str : "", -1);
+    folded = g_utf8_casefold(valid, -1);
+    g_free(valid);
+    key = g_utf8_collate_key(folded, -1);
+    g_free(folded);
+
+    return key;
+}
@@ -0,0 +1,213 @@
+/* -*-mode:c; c-style:k&r; c-basic-offset:4; -*- */
+/* Balsa E-Mail Client
+ *
+ * Copyright (C) 1997-2016 Stuart Parmenter and others,
+ *                         See the file AUTHORS for a list.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* sort_key_tst checks that the sender and subject sort keys order
+ * strings like a case-insensitive g_utf8_collate(), also for invalid
+ * UTF-8, and that reply and forward prefixes are chopped.
+ *
+ * Usage: sort_key_tst [SEED] [COUNT]
+ */
+
+#if defined(HAVE_CONFIG_H) && HAVE_CONFIG_H
+# include "config.h"
+#endif                          /* HAVE_CONFIG_H */
+#include "sort-key.h"
+
+#include <locale.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SIGN(x) (((x) > 0) - ((x) < 0))
+
+/* The reference order: collate the case-folded, valid strings. */
+static gint
+reference_compare(const gchar * a, const gchar * b)
+{
+    gchar *valid_a = g_utf8_make_valid(a, -1);
+    gchar *valid_b = g_utf8_make_valid(b, -1);
+    gchar *folded_a = g_utf8_casefold(valid_a, -1);
+    gchar *folded_b = g_utf8_casefold(valid_b, -1);
+    gint res = g_utf8_collate(folded_a, folded_b);
+
+    g_free(valid_a);
+    g_free(valid_b);
+    g_free(folded_a);
+    g_free(folded_b);
+
+    return SIGN(res);
+}
+
+static gint
+compare_keys(const gchar * a, const gchar * b)
+{
+    gchar *key_a = libbalsa_sort_key(a);
+    gchar *key_b = libbalsa_sort_key(b);
+    gint res = strcmp(key_a, key_b);
+
+    g_free(key_a);
+    g_free(key_b);
+
+    return SIGN(res);
+}
+
+static gint
+check_pair(const gchar * a, const gchar * b)
+{
+    gint ref = reference_compare(a, b);
+    gint res = compare_keys(a, b);
+
+    if (ref != res) {
+        gchar *esc_a = g_strescape(a, NULL);
+        gchar *esc_b = g_strescape(b, NULL);
+
+        printf("“%s” vs “%s”: keys compare %d, expected %d\n",
+               esc_a, esc_b, res, ref);
+        g_free(esc_a);
+        g_free(esc_b);
+        return 1;
+    }
+
+    return 0;
+}
+
+static gint
+test_ordering(void)
+{
+    static const gchar *const strings[] = {
+        "", "a", "A", "b", "B", "abc", "ABC", "Abd", "z", "Zürich",
+        "zurich", "Ärger", "arger", "Ørsted", "Œuvre", "straße",
+        "STRASSE", "中文", "a b", "a-b", "10", "9",
+        "inv\377alid", "b\377", "\377", "a\300\200"
+    };
+    gint failure_count = 0;
+    guint i, j;
+
+    for (i = 0; i < G_N_ELEMENTS(strings); i++)
+        for (j = 0; j < G_N_ELEMENTS(strings); j++)
+            failure_count += check_pair(strings[i], strings[j]);
+
+    /* Case must not matter. */
+    if (compare_keys("Hello World", "hELLO wORLD") != 0) {
+        printf("keys of “Hello World” and “hELLO wORLD” differ\n");
+        failure_count++;
+    }
+    /* A missing value sorts like an empty one. */
+    if (compare_keys(NULL, "") != 0) {
+        printf("keys of NULL and “” differ\n");
+        failure_count++;
+    }
+    /* An invalid string sorts between its valid neighbours. */
+    if (compare_keys("a", "b\377") >= 0 || compare_keys("b\377", "c") >= 0) {
+        printf("“b\\377” does not sort between “a” and “c”\n");
+        failure_count++;
+    }
+
+    return failure_count;
+}
+
+/* Random strings, including invalid UTF-8, must be ordered consistently
+ * with the reference. */
+static gint
+test_random(guint32 seed, gint count)
+{
+    static const gchar *const fragments[] = {
+        "a", "B", "c", "Z", "0", " ", "-", "\303\244", "\303\204",
+        "\303\237", "\344\270\255", "\377", "\300", "\200", "\342\202"
+    };
+    GRand *rand = g_rand_new_with_seed(seed);
+    gint failure_count = 0;
+
+    while (count-- > 0 && failure_count < 10) {
+        gchar *str[2];
+        guint k;
+
+        for (k = 0; k < 2; k++) {
+            GString *s = g_string_new(NULL);
+            gint n = g_rand_int_range(rand, 0, 8);
+
+            while (n-- > 0)
+                g_string_append(s,
+                                fragments[g_rand_int_range(rand, 0,
+                                                           G_N_ELEMENTS
+                                                           (fragments))]);
+            str[k] = g_string_free(s, FALSE);
+        }
+        failure_count += check_pair(str[0], str[1]);
+        g_free(str[0]);
+        g_free(str[1]);
+    }
+    g_rand_free(rand);
+
+    if (failure_count > 0)
+        printf("random sort key check failed, seed %u\n", seed);
+
+    return failure_count;
+}
+
+static gint
+test_subject_prefixes(void)
+{
+    static const struct {
+        const gchar *test, *reference;
+    } subjects[] = {
+        { "Re: hello", "hello" },
+        { "RE:Fwd: AW:  fw: hello", "hello" },
+        { "  re: re: hello re: world", "hello re: world" },
+        { "Reply", "Reply" },
+        { "Fwd", "Fwd" },
+        { "Re:", "" },
+        { "", "" }
+    };
+    gint failure_count = 0;
+    guint i;
+
+    for (i = 0; i < G_N_ELEMENTS(subjects); i++) {
+        const gchar *res =
+            libbalsa_chop_subject_prefixes(subjects[i].test);
+
+        if (strcmp(res, subjects[i].reference) != 0) {
+            printf("subject “%s”: expected “%s”, found “%s”\n",
+                   subjects[i].test, subjects[i].reference, res);
+            failure_count++;
+        }
+    }
+
+    return failure_count;
+}
+
+int
+main(int argc, char *argv[])
+{
+    guint32 seed;
+    gint count;
+    gint failure_count = 0;
+
+    setlocale(LC_ALL, "");
+
+    seed = argc > 1 ? (guint32) strtoul(argv[1], NULL, 10) : 20170415U;
+    count = argc > 2 ? atoi(argv[2]) : 100000;
+
+    failure_count += test_ordering();
+    failure_count += test_random(seed, count);
+    failure_count += test_subject_prefixes();
+
+    return failure_count > 0 ? 1 : 0;
+}
@@ -0,0 +1,115 @@
+/* -*-mode:c; c-style:k&r; c-basic-offset:4; -*- */
+/* Balsa E-Mail Client
+ *
+ * Copyright (C) 1997-2016 Stuart Parmenter and others,
+ *                         See the file AUTHORS for a list.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option) 
+ * any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the  
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* The thread date cache depends only on GLib, so that thread_dates_tst
+ * can be built without the rest of libbalsa. */
+#if defined(HAVE_CONFIG_H) && HAVE_CONFIG_H
+# include "config.h"
+#endif                          /* HAVE_CONFIG_H */
+#include "thread-dates.h"
+
+/* Thread dates: the latest message date in a subtree of a message tree
+ * is needed for sorting a threaded view by date.  It is cached for each
+ * node with children and kept across sorts; a newly known message date
+ * raises the cached dates of its node and ancestors, and removing or
+ * moving a node drops the cached dates of its ancestors, to be
+ * recomputed from the subtree when they are next needed.  The caller
+ * serializes access to the cache. */
+
+GHashTable *
+libbalsa_thread_dates_new(void)
+{
+    return g_hash_table_new_full(NULL, NULL, NULL, g_free);
+}
+
+/* Drop the cached dates of node and its ancestors. */
+void
+libbalsa_thread_dates_invalidate(GHashTable * thread_dates, GNode * node)
+{
+    for (; node != NULL; node = node->parent)
+        g_hash_table_remove(thread_dates, node);
+}
+
+static gboolean
+thread_dates_remove_func(GNode * node, gpointer data)
+{
+    g_hash_table_remove((GHashTable *) data, node);
+
+    return FALSE;
+}
+
+/* Drop the cached dates of node, its ancestors and its descendants,
+ * before the node is destroyed. */
+void
+libbalsa_thread_dates_remove(GHashTable * thread_dates, GNode * node)
+{
+    GNode *parent;
+
+    g_node_traverse(node, G_IN_ORDER, G_TRAVERSE_NON_LEAVES, -1,
+                    thread_dates_remove_func, thread_dates);
+    for (parent = node->parent; parent != NULL; parent = parent->parent)
+        g_hash_table_remove(thread_dates, parent);
+}
+
+/* The message at node has the date msg_date: raise the cached dates of
+ * node, which include its own date, and of its ancestors. */
+void
+libbalsa_thread_dates_raise(GHashTable * thread_dates, GNode * node,
+                            time_t msg_date)
+{
+    for (; node != NULL; node = node->parent) {
+        time_t *thread_date = g_hash_table_lookup(thread_dates, node);
+
+        if (thread_date != NULL && *thread_date < msg_date)
+            *thread_date = msg_date;
+    }
+}
+
+/* Latest date in the subtree of node. */
+time_t
+libbalsa_thread_date(GHashTable * thread_dates, GNode * node,
+                     LibBalsaMessageDateFunc date_func, gpointer data)
+{
+    time_t *cached;
+    time_t thread_date;
+    GNode *child;
+
+    if (node->children != NULL
+        && (cached = g_hash_table_lookup(thread_dates, node)) != NULL)
+        return *cached;
+
+    thread_date = date_func(node, data);
+
+    for (child = node->children; child != NULL; child = child->next) {
+        time_t child_date =
+            libbalsa_thread_date(thread_dates, child, date_func, data);
+
+        if (child_date > thread_date)
+            thread_date = child_date;
+    }
+
+    if (node->children != NULL) {
+        cached = g_new(time_t, 1);
+        *cached = thread_date;
+        g_hash_table_insert(thread_dates, node, cached);
+    }
+
+    return thread_date;
+}
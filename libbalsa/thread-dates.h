@@ -0,0 +1,41 @@
+/* -*-mode:c; c-style:k&r; c-basic-offset:4; -*- */
+/* Balsa E-Mail Client
+ *
+ * Copyright (C) 1997-2016 Stuart Parmenter and others,
+ *                         See the file AUTHORS for a list.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option) 
+ * any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the  
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef __LIBBALSA_THREAD_DATES_H__
+#define __LIBBALSA_THREAD_DATES_H__
+
+#include <time.h>
+#include <glib.h>
+
+/* The date of the message at node, or 0 if it is not known. */
+typedef time_t (*LibBalsaMessageDateFunc) (GNode * node, gpointer data);
+
+GHashTable *libbalsa_thread_dates_new(void);
+void libbalsa_thread_dates_invalidate(GHashTable * thread_dates,
+                                      GNode * node);
+void libbalsa_thread_dates_remove(GHashTable * thread_dates,
+                                  GNode * node);
+void libbalsa_thread_dates_raise(GHashTable * thread_dates,
+                                 GNode * node, time_t msg_date);
+time_t libbalsa_thread_date(GHashTable * thread_dates, GNode * node,
+                            LibBalsaMessageDateFunc date_func,
+                            gpointer data);
+
+#endif                          /* __LIBBALSA_THREAD_DATES_H__ */
@@ -0,0 +1,319 @@
+/* -*-mode:c; c-style:k&r; c-basic-offset:4; -*- */
+/* Balsa E-Mail Client
+ *
+ * Copyright (C) 1997-2016 Stuart Parmenter and others,
+ *                         See the file AUTHORS for a list.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option) 
+ * any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the  
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* thread_dates_tst checks the thread date cache against the latest date
+ * computed from the subtree, while a random message tree is changed the
+ * way LibBalsaMailbox changes msg_tree: message dates become known,
+ * messages are inserted, removed with their children promoted, moved
+ * to another parent or destroyed with their subtree, and the tree is
+ * replaced.
+ *
+ * Usage: thread_dates_tst [SEED] [COUNT]
+ */
+
+#if defined(HAVE_CONFIG_H) && HAVE_CONFIG_H
+# include "config.h"
+#endif                          /* HAVE_CONFIG_H */
+#include "thread-dates.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MAX_NODES 64
+
+typedef struct {
+    GRand *rand;
+    GArray *dates;              /* the date of each message, 0 if
+                                 * it is not known yet */
+    GArray *true_dates;         /* the date it will get */
+    GHashTable *thread_dates;
+    GNode *root;
+} ThreadDatesTest;
+
+static time_t
+message_date(GNode * node, gpointer data)
+{
+    ThreadDatesTest *test = data;
+
+    return g_array_index(test->dates, time_t, GPOINTER_TO_UINT(node->data));
+}
+
+static gboolean
+reference_date_func(GNode * node, gpointer data)
+{
+    ThreadDatesTest *test = ((gpointer *) data)[0];
+    time_t *thread_date = ((gpointer *) data)[1];
+    time_t msg_date = message_date(node, test);
+
+    if (msg_date > *thread_date)
+        *thread_date = msg_date;
+
+    return FALSE;
+}
+
+static time_t
+reference_date(ThreadDatesTest * test, GNode * node)
+{
+    time_t thread_date = 0;
+    gpointer data[] = { test, &thread_date };
+
+    g_node_traverse(node, G_IN_ORDER, G_TRAVERSE_ALL, -1,
+                    reference_date_func, data);
+
+    return thread_date;
+}
+
+static gboolean
+collect_func(GNode * node, gpointer data)
+{
+    g_ptr_array_add((GPtrArray *) data, node);
+
+    return FALSE;
+}
+
+/* All nodes in the subtree of node, in random order. */
+static GPtrArray *
+collect_nodes(ThreadDatesTest * test, GNode * node)
+{
+    GPtrArray *nodes = g_ptr_array_new();
+    guint i;
+
+    g_node_traverse(node, G_IN_ORDER, G_TRAVERSE_ALL, -1, collect_func,
+                    nodes);
+    for (i = nodes->len; i > 1; i--) {
+        guint j = g_rand_int_range(test->rand, 0, i);
+        gpointer tmp = g_ptr_array_index(nodes, i - 1);
+
+        g_ptr_array_index(nodes, i - 1) = g_ptr_array_index(nodes, j);
+        g_ptr_array_index(nodes, j) = tmp;
+    }
+
+    return nodes;
+}
+
+/* A random node other than the root, or NULL. */
+static GNode *
+random_message(ThreadDatesTest * test)
+{
+    GPtrArray *nodes = collect_nodes(test, test->root);
+    GNode *node = NULL;
+    guint i;
+
+    for (i = 0; i < nodes->len && node == NULL; i++)
+        if (g_ptr_array_index(nodes, i) != test->root)
+            node = g_ptr_array_index(nodes, i);
+    g_ptr_array_free(nodes, TRUE);
+
+    return node;
+}
+
+static gint
+check_node(ThreadDatesTest * test, GNode * node)
+{
+    time_t cached =
+        libbalsa_thread_date(test->thread_dates, node, message_date, test);
+    time_t reference = reference_date(test, node);
+
+    if (cached != reference) {
+        printf("message %u: thread date %ld, expected %ld\n",
+               GPOINTER_TO_UINT(node->data), (glong) cached,
+               (glong) reference);
+        return 1;
+    }
+
+    return 0;
+}
+
+static gint
+check_all_nodes(ThreadDatesTest * test)
+{
+    GPtrArray *nodes = collect_nodes(test, test->root);
+    gint failure_count = 0;
+    guint i;
+
+    for (i = 0; i < nodes->len; i++)
+        failure_count += check_node(test, g_ptr_array_index(nodes, i));
+    g_ptr_array_free(nodes, TRUE);
+
+    return failure_count;
+}
+
+/* Like libbalsa_mailbox_msgno_changed(). */
+static void
+fill_date(ThreadDatesTest * test, GNode * node)
+{
+    guint msgno = GPOINTER_TO_UINT(node->data);
+
+    g_array_index(test->dates, time_t, msgno) =
+        g_array_index(test->true_dates, time_t, msgno);
+    libbalsa_thread_dates_raise(test->thread_dates, node,
+                                g_array_index(test->dates, time_t, msgno));
+}
+
+/* Like libbalsa_mailbox_msgno_inserted(). */
+static void
+insert_message(ThreadDatesTest * test, GNode * parent)
+{
+    time_t msg_date = g_rand_int_range(test->rand, 1, 1000);
+    time_t unknown = 0;
+    GNode *node = g_node_new(GUINT_TO_POINTER(test->dates->len));
+
+    g_array_append_val(test->true_dates, msg_date);
+    if (g_rand_boolean(test->rand))
+        g_array_append_val(test->dates, msg_date);
+    else
+        g_array_append_val(test->dates, unknown);
+    g_node_insert_after(parent, g_node_last_child(parent), node);
+    if (message_date(node, test) > 0)
+        libbalsa_thread_dates_raise(test->thread_dates, node,
+                                    message_date(node, test));
+}
+
+/* Like libbalsa_mailbox_msgno_removed(). */
+static void
+remove_message(ThreadDatesTest * test, GNode * node)
+{
+    GNode *parent = node->parent;
+    GNode *child;
+
+    libbalsa_thread_dates_invalidate(test->thread_dates, node);
+    while ((child = node->children) != NULL) {
+        g_node_unlink(child);
+        g_node_insert_before(parent, node, child);
+    }
+    g_node_unlink(node);
+    g_node_destroy(node);
+}
+
+/* Like libbalsa_mailbox_unlink_and_prepend(). */
+static void
+move_message(ThreadDatesTest * test, GNode * node, GNode * parent)
+{
+    GNode *current_parent = node->parent;
+
+    if (parent == NULL)
+        libbalsa_thread_dates_remove(test->thread_dates, node);
+    else
+        libbalsa_thread_dates_invalidate(test->thread_dates,
+                                         current_parent);
+    g_node_unlink(node);
+    if (parent == NULL) {
+        g_node_destroy(node);
+        return;
+    }
+    g_node_prepend(parent, node);
+    libbalsa_thread_dates_invalidate(test->thread_dates, parent);
+}
+
+/* Like libbalsa_mailbox_set_msg_tree(). */
+static void
+replace_tree(ThreadDatesTest * test)
+{
+    g_node_destroy(test->root);
+    g_hash_table_remove_all(test->thread_dates);
+    test->root = g_node_new(GUINT_TO_POINTER(0));
+}
+
+static gint
+test_random(guint32 seed, gint count)
+{
+    ThreadDatesTest test;
+    time_t unknown = 0;
+    gint failure_count = 0;
+
+    test.rand = g_rand_new_with_seed(seed);
+    test.dates = g_array_new(FALSE, FALSE, sizeof(time_t));
+    test.true_dates = g_array_new(FALSE, FALSE, sizeof(time_t));
+    /* msgno 0 is the root. */
+    g_array_append_val(test.dates, unknown);
+    g_array_append_val(test.true_dates, unknown);
+    test.thread_dates = libbalsa_thread_dates_new();
+    test.root = g_node_new(GUINT_TO_POINTER(0));
+
+    while (count-- > 0 && failure_count < 10) {
+        GNode *node = random_message(&test);
+        guint n_nodes = g_node_n_nodes(test.root, G_TRAVERSE_ALL);
+
+        switch (g_rand_int_range(test.rand, 0, 6)) {
+        case 0:
+            if (node != NULL && message_date(node, &test) == 0)
+                fill_date(&test, node);
+            break;
+        case 1:
+            if (n_nodes < MAX_NODES)
+                insert_message(&test, node != NULL
+                               && g_rand_boolean(test.rand) ?
+                               node : test.root);
+            break;
+        case 2:
+            if (node != NULL)
+                remove_message(&test, node);
+            break;
+        case 3:
+            if (node != NULL) {
+                GNode *parent = random_message(&test);
+
+                if (parent == NULL || g_rand_int_range(test.rand, 0, 4) == 0)
+                    parent = test.root;
+                if (parent != node && !g_node_is_ancestor(node, parent))
+                    move_message(&test, node, parent);
+            }
+            break;
+        case 4:
+            if (node != NULL && g_rand_int_range(test.rand, 0, 4) == 0)
+                move_message(&test, node, NULL);
+            else if (n_nodes == MAX_NODES
+                     || g_rand_int_range(test.rand, 0, 100) == 0)
+                replace_tree(&test);
+            break;
+        default:
+            if (node != NULL)
+                failure_count += check_node(&test, node);
+            break;
+        }
+
+        if (count % 8 == 0)
+            failure_count += check_all_nodes(&test);
+    }
+    failure_count += check_all_nodes(&test);
+
+    g_node_destroy(test.root);
+    g_hash_table_destroy(test.thread_dates);
+    g_array_free(test.dates, TRUE);
+    g_array_free(test.true_dates, TRUE);
+    g_rand_free(test.rand);
+
+    if (failure_count > 0)
+        printf("random thread date check failed, seed %u\n", seed);
+
+    return failure_count;
+}
+
+int
+main(int argc, char *argv[])
+{
+    guint32 seed;
+    gint count;
+
+    seed = argc > 1 ? (guint32) strtoul(argv[1], NULL, 10) : 20170415U;
+    count = argc > 2 ? atoi(argv[2]) : 100000;
+
+    return test_random(seed, count) > 0 ? 1 : 0;
+}
@@ -0,0 +1,132 @@
+/* -*-mode:c; c-style:k&r; c-basic-offset:4; -*- */
+/* Balsa E-Mail Client
+ *
+ * Copyright (C) 1997-2016 Stuart Parmenter and others,
+ *                         See the file AUTHORS for a list.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option) 
+ * any later version.
+ *  
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of 
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the  
+ * GNU General Public License for more details.
+ *  
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* The URL scanner depends only on GLib, so that url_tst can be built
+ * without the rest of libbalsa. */
+#if defined(HAVE_CONFIG_H) && HAVE_CONFIG_H
+# include "config.h"
+#endif                          /* HAVE_CONFIG_H */
+#include "url-scanner.h"
+
+#include <string.h>
+
+/* libbalsa_find_url:
+ * find the first URL in the text between text and text_end, and return
+ * its byte offsets in start_pos and end_pos.
+ *
+ * This is a hand-written equivalent of the (case insensitive) regex
+ *   (((https?|ftps?|nntp)://)|(mailto:|news:))
+ *   (%[0-9A-F]{2}|[-_.!~*';/?:@&=+$,#[:alnum:]])+
+ *   (%[0-9A-F]{2}|[-_!~*';/?:@&=+$#[:alnum:]])
+ * scanning the text once, so the cost is linear in its length.  A
+ * trailing period or comma is not included in the match; it is more
+ * likely to be punctuation than part of an URL.
+ */
+static const struct {
+    const gchar *scheme;
+    gsize len;
+} url_schemes[] = {
+    { "http://",  7 },
+    { "https://", 8 },
+    { "ftp://",   6 },
+    { "ftps://",  7 },
+    { "nntp://",  7 },
+    { "mailto:",  7 },
+    { "news:",    5 }
+};
+
+/* Length of the URL character or %-escape at p, or 0 if there is none;
+ * is_punct is set for a period or a comma. */
+static gsize
+url_char_len(const gchar * p, const gchar * text_end, gboolean * is_punct)
+{
+    guchar c = *p;
+    gunichar uc;
+
+    *is_punct = FALSE;
+    if (c == '%')
+        return text_end - p >= 3
+            && g_ascii_isxdigit(p[1]) && g_ascii_isxdigit(p[2]) ? 3 : 0;
+    if (c == '.' || c == ',') {
+        *is_punct = TRUE;
+        return 1;
+    }
+    if (c < 0x80)
+        return c != '\0'
+            && (g_ascii_isalnum(c) || strchr("-_!~*';/?:@&=+$#", c)) ? 1 : 0;
+
+    uc = g_utf8_get_char_validated(p, text_end - p);
+    if (uc == (gunichar) -1 || uc == (gunichar) -2 || !g_unichar_isalnum(uc))
+        return 0;
+
+    return g_utf8_next_char(p) - p;
+}
+
+gboolean
+libbalsa_find_url(const gchar * text, const gchar * text_end,
+                  gint * start_pos, gint * end_pos)
+{
+    const gchar *p;
+
+    for (p = text; p < text_end; p++) {
+        guint i;
+
+        switch (*p) {
+        case 'f': case 'F': case 'h': case 'H':
+        case 'm': case 'M': case 'n': case 'N':
+            break;
+        default:
+            continue;
+        }
+
+        for (i = 0; i < G_N_ELEMENTS(url_schemes); i++) {
+            const gchar *q;
+            const gchar *url_end;
+            guint count;
+            gsize len;
+            gboolean is_punct;
+
+            if ((gsize) (text_end - p) <= url_schemes[i].len
+                || g_ascii_strncasecmp(p, url_schemes[i].scheme,
+                                       url_schemes[i].len) != 0)
+                continue;
+
+            /* at least two URL characters, the last one not being
+             * punctuation */
+            url_end = NULL;
+            count = 0;
+            for (q = p + url_schemes[i].len;
+                 q < text_end
+                 && (len = url_char_len(q, text_end, &is_punct)) > 0;
+                 q += len) {
+                if (++count >= 2 && !is_punct)
+                    url_end = q + len;
+            }
+
+            if (url_end != NULL) {
+                *start_pos = p - text;
+                *end_pos = url_end - text;
+                return TRUE;
+            }
+        }
+    }
+
+    return FALSE;
+}
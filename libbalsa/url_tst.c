@@ -0,0 +1,162 @@
+/* -*-mode:c; c-style:k&r; c-basic-offset:4; -*- */
+/* Balsa E-Mail Client
+ *
+ * Copyright (C) 1997-2016 Stuart Parmenter and others,
+ *                         See the file AUTHORS for a list.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* url_tst checks that libbalsa_find_url() finds the same URLs as the
+ * regex it replaced, on a fixed corpus and on random text.
+ *
+ * Usage: url_tst [SEED] [COUNT]
+ */
+
+#if defined(HAVE_CONFIG_H) && HAVE_CONFIG_H
+# include "config.h"
+#endif                          /* HAVE_CONFIG_H */
+#include "url-scanner.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The URL regex used before libbalsa_find_url(). */
+#define URL_REGEX                                        \
+    "(((https?|ftps?|nntp)://)|(mailto:|news:))"         \
+    "(%[0-9A-F]{2}|[-_.!~*';/?:@&=+$,#[:alnum:]])+"      \
+    "(%[0-9A-F]{2}|[-_!~*';/?:@&=+$#[:alnum:]])"
+
+/* Compare all matches in text; returns the number of differences,
+ * which are printed. */
+static gint
+compare_urls(GRegex * url_reg, const gchar * text)
+{
+    const gchar *p = text;
+    const gchar * const text_end = text + strlen(text);
+
+    for (;;) {
+        GMatchInfo *url_match;
+        gboolean reg_found;
+        gboolean scan_found;
+        gint reg_start = -1, reg_end = -1;
+        gint scan_start = -1, scan_end = -1;
+
+        reg_found = g_regex_match(url_reg, p, 0, &url_match)
+            && g_match_info_fetch_pos(url_match, 0, &reg_start, &reg_end);
+        g_match_info_free(url_match);
+        scan_found = libbalsa_find_url(p, text_end, &scan_start, &scan_end);
+
+        if (reg_found != scan_found
+            || (reg_found && (reg_start != scan_start
+                              || reg_end != scan_end))) {
+            printf("“%s”: regex %d:%d, scanner %d:%d at offset %ld\n",
+                   text, reg_start, reg_end, scan_start, scan_end,
+                   (glong) (p - text));
+            return 1;
+        }
+        if (!reg_found)
+            return 0;
+        p += reg_end;
+    }
+}
+
+/* Random text built from fragments which exercise the URL grammar. */
+static gchar *
+random_text(GRand * rand)
+{
+    static const gchar *const fragments[] = {
+        "http://", "HTTPS://", "ftp://", "ftps:/", "nntp://", "mailto:",
+        "News:", "http:", "htt", "m", "a", "Z", "0", "%", "%4", "%41",
+        "%4g", "%e9", ".", ",", "-", "_", "~", "'", "/", "?", "=", "#",
+        "$", "@", "+", ";", "*", "!", " ", "\t", "<", ">", "\"", "(",
+        ")", "[", "\n", "\303\244",     /* ä */
+        "\342\202\254",                 /* € */
+        "\344\270\255"                  /* 中 */
+    };
+    GString *text = g_string_new(NULL);
+    gint n = g_rand_int_range(rand, 1, 40);
+
+    while (n-- > 0)
+        g_string_append(text,
+                        fragments[g_rand_int_range(rand, 0,
+                                                   G_N_ELEMENTS
+                                                   (fragments))]);
+
+    return g_string_free(text, FALSE);
+}
+
+int
+main(int argc, char *argv[])
+{
+    static const gchar *const corpus[] = {
+        "",
+        "no url here",
+        "see http://www.example.com/ for details",
+        "HTTPS://Example.COM/path?query=1&b=2#frag.",
+        "trailing punctuation: http://example.com/a, and http://x.org.",
+        "mailto:someone@example.com",
+        "news:comp.mail.misc and nntp://news.example.com/group",
+        "ftp://ftp.example.com/pub/file.tar.gz; ftps://secure.example.com",
+        "escaped http://example.com/%41%42%4 and %zz",
+        "http://a",
+        "http://a.",
+        "http://ab",
+        "http:// spaced",
+        "xhttp://embedded.example.com",
+        "<http://example.com/bracketed>",
+        "\"http://example.com/quoted\"",
+        "http://example.com/päth/\344\270\255",
+        "http://example.com/\342\202\254uro",
+        "two urls: http://a.example/x http://b.example/y.",
+        "mailto:a@b.c,mailto:d@e.f"
+    };
+    GRegex *url_reg;
+    GError *err = NULL;
+    GRand *rand;
+    guint32 seed;
+    gint count;
+    gint failure_count = 0;
+    guint i;
+
+    seed = argc > 1 ? (guint32) strtoul(argv[1], NULL, 10) : 20170415U;
+    count = argc > 2 ? atoi(argv[2]) : 100000;
+
+    url_reg = g_regex_new(URL_REGEX, G_REGEX_CASELESS, 0, &err);
+    if (url_reg == NULL) {
+        printf("url regex compilation failed: %s\n", err->message);
+        g_error_free(err);
+        return 1;
+    }
+
+    for (i = 0; i < G_N_ELEMENTS(corpus); i++)
+        failure_count += compare_urls(url_reg, corpus[i]);
+
+    rand = g_rand_new_with_seed(seed);
+    while (count-- > 0 && failure_count < 10) {
+        gchar *text = random_text(rand);
+
+        failure_count += compare_urls(url_reg, text);
+        g_free(text);
+    }
+    g_rand_free(rand);
+    g_regex_unref(url_reg);
+
+    if (failure_count > 0)
+        printf("%d URL scanner check(s) failed, seed %u\n",
+               failure_count, seed);
+
+    return failure_count > 0 ? 1 : 0;
+}
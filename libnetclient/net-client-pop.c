@@ -14,6 +14,7 @@
 
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <glib/gi18n.h>
 #include "net-client-utils.h"
 #include "net-client-pop.h"
@@ -71,7 +72,10 @@ struct _NetClientPop {
  * CRLF, see RFC 5322, Sect. 2.1.1.  However, it also states that "Receiving implementations would do well to handle an arbitrarily
  * large number of characters in a line for robustness sake", so we actually accept lines from POP3 of unlimited length. */
 #define MAX_POP_LINE_LEN			0U
-#define POP_DATA_BUF_SIZE			4096U
+#define POP_DATA_BUF_SIZE			NET_CLIENT_BLOCK_SIZE
+
+/* Maximum number of outstanding commands when pipelining, see RFC 2449, Sect. 6.6 */
+#define POP_PIPELINE_WINDOW			64U
 
 
 /*lint -save -e9026		allow function-like macros, see MISRA C:2012, Directive 4.9 */
@@ -105,6 +109,8 @@ static gboolean net_client_pop_auth_cram(NetClientPop *client, GChecksumType chk
 static gboolean net_client_pop_auth_gssapi(NetClientPop *client, const gchar *user, GError **error);
 static gboolean net_client_pop_retr_msg(NetClientPop *client, const NetClientPopMessageInfo *info, NetClientPopMsgCb callback,
 										gpointer user_data, GError **error);
+static gboolean net_client_pop_send_window(NetClientPop *client, const gchar *command, const GList **next, guint count,
+										   GError **error);
 
 
 NetClientPop *
@@ -404,21 +410,16 @@ net_client_pop_retr(NetClientPop *client, GList *msg_list, NetClientPopMsgCb cal
 	gboolean result;
 	gboolean pipelining;
 	const GList *p;
+	const GList *next_cmd;
 
 	/* paranoia checks */
 	g_return_val_if_fail(NET_IS_CLIENT_POP(client) && (msg_list != NULL) && (callback != NULL), FALSE);
 
-	/* pipelining: send all RETR commands */
-	pipelining = client->can_pipelining && client->use_pipelining;
+	/* pipelining: send the first window of RETR commands */
+	pipelining = net_client_pop_can_pipelining(client);
+	next_cmd = msg_list;
 	if (pipelining) {
-		GString *retr_buf;
-
-		retr_buf = g_string_sized_new(10U * g_list_length(msg_list));
-		for (p = msg_list; p != NULL; p = p->next) {
-			g_string_append_printf(retr_buf, "RETR %u\r\n", POP_MSG_INFO(p)->id);
-		}
-		result = net_client_write_buffer(NET_CLIENT(client), retr_buf->str, retr_buf->len, error);
-		(void) g_string_free(retr_buf, TRUE);
+		result = net_client_pop_send_window(client, "RETR", &next_cmd, POP_PIPELINE_WINDOW, error);
 	} else {
 		result = TRUE;
 	}
@@ -428,6 +429,10 @@ net_client_pop_retr(NetClientPop *client, GList *msg_list, NetClientPopMsgCb cal
 
 		if (pipelining) {
 			result = net_client_pop_read_reply(client, NULL, error);
+			/* keep the window filled, so the server can send the next message while we process this one */
+			if (result) {
+				result = net_client_pop_send_window(client, "RETR", &next_cmd, 1U, error);
+			}
 		} else {
 			result = net_client_pop_execute(client, "RETR %u", NULL, error, info->id);
 		}
@@ -446,21 +451,16 @@ net_client_pop_dele(NetClientPop *client, GList *msg_list, GError **error)
 	gboolean result;
 	gboolean pipelining;
 	const GList *p;
+	const GList *next_cmd;
 
 	/* paranoia checks */
 	g_return_val_if_fail(NET_IS_CLIENT_POP(client) && (msg_list != NULL), FALSE);
 
-	/* pipelining: send all DELE commands */
-	pipelining = client->can_pipelining && client->use_pipelining;
+	/* pipelining: send the first window of DELE commands */
+	pipelining = net_client_pop_can_pipelining(client);
+	next_cmd = msg_list;
 	if (pipelining) {
-		GString *dele_buf;
-
-		dele_buf = g_string_sized_new(10U * g_list_length(msg_list));
-		for (p = msg_list; p != NULL; p = p->next) {
-			g_string_append_printf(dele_buf, "DELE %u\r\n", POP_MSG_INFO(p)->id);
-		}
-		result = net_client_write_buffer(NET_CLIENT(client), dele_buf->str, dele_buf->len, error);
-		(void) g_string_free(dele_buf, TRUE);
+		result = net_client_pop_send_window(client, "DELE", &next_cmd, POP_PIPELINE_WINDOW, error);
 	} else {
 		result = TRUE;
 	}
@@ -470,6 +470,9 @@ net_client_pop_dele(NetClientPop *client, GList *msg_list, GError **error)
 
 		if (pipelining) {
 			result = net_client_pop_read_reply(client, NULL, error);
+			if (result) {
+				result = net_client_pop_send_window(client, "DELE", &next_cmd, 1U, error);
+			}
 		} else {
 			result = net_client_pop_execute(client, "DELE %u", NULL, error, info->id);
 		}
@@ -480,6 +483,15 @@ net_client_pop_dele(NetClientPop *client, GList *msg_list, GError **error)
 }
 
 
+gboolean
+net_client_pop_can_pipelining(NetClientPop *client)
+{
+	g_return_val_if_fail(NET_IS_CLIENT_POP(client), FALSE);
+
+	return client->can_pipelining && client->use_pipelining;
+}
+
+
 void
 net_client_pop_msg_info_free(NetClientPopMessageInfo *info)
 {
@@ -492,6 +504,32 @@ net_client_pop_msg_info_free(NetClientPopMessageInfo *info)
 
 /* == local functions =========================================================================================================== */
 
+/* Send the passed command for up to count messages, starting at *next, in a single write operation, and advance *next.  Used for
+ * pipelining where the number of outstanding commands is limited to POP_PIPELINE_WINDOW, so neither side can block on a full
+ * TCP send buffer (RFC 2449, Sect. 6.6). */
+static gboolean
+net_client_pop_send_window(NetClientPop *client, const gchar *command, const GList **next, guint count, GError **error)
+{
+	GString *cmd_buf;
+	guint n;
+	gboolean result;
+
+	cmd_buf = g_string_sized_new(16U * count);
+	for (n = 0U; (n < count) && (*next != NULL); n++) {
+		g_string_append_printf(cmd_buf, "%s %u\r\n", command, POP_MSG_INFO(*next)->id);
+		*next = (*next)->next;
+	}
+	if (cmd_buf->len > 0U) {
+		result = net_client_write_buffer(NET_CLIENT(client), cmd_buf->str, cmd_buf->len, error);
+	} else {
+		result = TRUE;
+	}
+	(void) g_string_free(cmd_buf, TRUE);
+
+	return result;
+}
+
+
 static void
 net_client_pop_class_init(NetClientPopClass *klass)
 {
@@ -990,43 +1028,107 @@ net_client_pop_uidl(NetClientPop *client, GList * const *msg_list, GError **erro
 }
 
 
+/* documentation: see header file */
+gsize
+net_client_pop_decode_block(const gchar *data, gsize count, NetClientPopDecState *state, GString *msg_buf, gsize *lines)
+{
+	gsize pos = 0U;
+
+	while ((pos < count) && (*state != NET_CLIENT_POP_DEC_DONE)) {
+		switch (*state) {
+		case NET_CLIENT_POP_DEC_BOL:
+			if (data[pos] == '.') {
+				pos++;
+				*state = NET_CLIENT_POP_DEC_DOT;
+			} else {
+				*state = NET_CLIENT_POP_DEC_TEXT;
+			}
+			break;
+		case NET_CLIENT_POP_DEC_DOT:
+			if (data[pos] == '\r') {
+				pos++;
+				*state = NET_CLIENT_POP_DEC_DOT_CR;
+			} else {
+				*state = NET_CLIENT_POP_DEC_TEXT;			/* drop the stuffed '.' */
+			}
+			break;
+		case NET_CLIENT_POP_DEC_DOT_CR:
+			if (data[pos] == '\n') {
+				pos++;
+				*state = NET_CLIENT_POP_DEC_DONE;
+			} else {
+				msg_buf = g_string_append_c(msg_buf, '\r');
+				*state = NET_CLIENT_POP_DEC_TEXT;
+			}
+			break;
+		case NET_CLIENT_POP_DEC_TEXT: {
+			const gchar *cr;
+
+			cr = memchr(&data[pos], '\r', count - pos);
+			if (cr == NULL) {
+				msg_buf = g_string_append_len(msg_buf, &data[pos], (gssize) (count - pos));
+				pos = count;
+			} else {
+				msg_buf = g_string_append_len(msg_buf, &data[pos], cr - &data[pos]);
+				pos = (gsize) (cr - data) + 1U;
+				*state = NET_CLIENT_POP_DEC_CR;
+			}
+			break;
+		}
+		case NET_CLIENT_POP_DEC_CR:
+			if (data[pos] == '\n') {
+				pos++;
+				msg_buf = g_string_append_c(msg_buf, '\n');
+				(*lines)++;
+				*state = NET_CLIENT_POP_DEC_BOL;
+			} else {
+				msg_buf = g_string_append_c(msg_buf, '\r');
+				*state = NET_CLIENT_POP_DEC_TEXT;
+			}
+			break;
+		default:
+			g_assert_not_reached();
+		}
+
+		/* return to the caller if the buffer is full and ends with a complete line */
+		if ((*state == NET_CLIENT_POP_DEC_BOL) && (msg_buf->len >= POP_DATA_BUF_SIZE)) {
+			break;
+		}
+	}
+
+	return pos;
+}
+
+
+/* Read the message data following a positive RETR response directly from the input buffer of the network client, without splitting
+ * it into lines, and pass it in large chunks of complete lines to the callback. */
 static gboolean
 net_client_pop_retr_msg(NetClientPop *client, const NetClientPopMessageInfo *info, NetClientPopMsgCb callback, gpointer user_data,
 						GError **error)
 {
 	gboolean result;
-	gboolean done;
+	NetClientPopDecState state;
 	GString *msg_buf;
 	gsize lines;
 
 	result = TRUE;
-	done = FALSE;
-	msg_buf = g_string_sized_new(POP_DATA_BUF_SIZE);
+	state = NET_CLIENT_POP_DEC_BOL;
+	msg_buf = g_string_sized_new(POP_DATA_BUF_SIZE + 1024U);
 	lines = 0U;
-	while (!done && result) {
-		gchar *linebuf;
+	while ((state != NET_CLIENT_POP_DEC_DONE) && result) {
+		const gchar *data;
+		gsize count;
 
-		result = net_client_read_line(NET_CLIENT(client), &linebuf, error);
+		result = net_client_peek_buffer(NET_CLIENT(client), &data, &count, error);
 		if (result) {
-			if (IS_ML_TERM(linebuf)) {
-				done = TRUE;
-			} else {
-				if (linebuf[0] == '.') {
-					msg_buf = g_string_append(msg_buf, &linebuf[1]);
-				} else {
-					msg_buf = g_string_append(msg_buf, linebuf);
-				}
-				msg_buf = g_string_append_c(msg_buf, '\n');
-				lines++;
+			net_client_skip_buffer(NET_CLIENT(client), net_client_pop_decode_block(data, count, &state, msg_buf, &lines));
 
-				/* pass an almost full buffer to the callback */
-				if (msg_buf->len > (POP_DATA_BUF_SIZE - 100U)) {
-					result = callback(msg_buf->str, (gssize) msg_buf->len, lines, info, user_data, error);
-					msg_buf = g_string_truncate(msg_buf, 0U);
-					lines = 0U;
-				}
+			/* pass a full buffer to the callback */
+			if ((state == NET_CLIENT_POP_DEC_BOL) && (msg_buf->len >= POP_DATA_BUF_SIZE)) {
+				result = callback(msg_buf->str, (gssize) msg_buf->len, lines, info, user_data, error);
+				msg_buf = g_string_truncate(msg_buf, 0U);
+				lines = 0U;
 			}
-			g_free(linebuf);
 		}
 	}
 
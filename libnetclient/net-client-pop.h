@@ -32,6 +32,7 @@ G_DECLARE_FINAL_TYPE(NetClientPop, net_client_pop, NET, CLIENT_POP, NetClient)
 
 typedef struct _NetClientPopMessage NetClientPopMessage;
 typedef struct _NetClientPopMessageInfo NetClientPopMessageInfo;
+typedef enum _NetClientPopDecState NetClientPopDecState;
 
 
 /** @brief POP-specific error codes */
@@ -44,6 +45,17 @@ enum _NetClientPopError {
 };
 
 
+/** @brief States of the RETR dot-unstuffing decoder */
+enum _NetClientPopDecState {
+	NET_CLIENT_POP_DEC_BOL = 0,			/**< At the beginning of a line. */
+	NET_CLIENT_POP_DEC_DOT,				/**< A '.' has been read at the beginning of a line. */
+	NET_CLIENT_POP_DEC_DOT_CR,			/**< ".\r" has been read at the beginning of a line. */
+	NET_CLIENT_POP_DEC_TEXT,			/**< Within a line. */
+	NET_CLIENT_POP_DEC_CR,				/**< A '\r' has been read within a line. */
+	NET_CLIENT_POP_DEC_DONE				/**< The terminating ".\r\n" has been read. */
+};
+
+
 /** @brief Message information
  *
  * This structure is returned in a GList by net_client_pop_list() and contains information about on message in the remote mailbox.
@@ -208,6 +220,18 @@ gboolean net_client_pop_retr(NetClientPop *client, GList *msg_list, NetClientPop
 gboolean net_client_pop_dele(NetClientPop *client, GList *msg_list, GError **error);
 
 
+/** @brief Check if POP3 pipelining is active
+ *
+ * @param client POP network client object
+ * @return TRUE if the remote server announced the RFC 2449 @em PIPELINING capability and its use has been enabled
+ *
+ * Note that the result is valid only after the connection has been established using net_client_pop_connect().  When pipelining
+ * is active, net_client_pop_retr() and net_client_pop_dele() send the commands in a sliding window and read the responses in order,
+ * so the number of round-trips does not depend on the number of messages.
+ */
+gboolean net_client_pop_can_pipelining(NetClientPop *client);
+
+
 /** @brief Free POP3 message item information
  *
  * @param info POP3 message item information as returned by net_client_pop_list()
@@ -217,6 +241,27 @@ gboolean net_client_pop_dele(NetClientPop *client, GList *msg_list, GError **err
 void net_client_pop_msg_info_free(NetClientPopMessageInfo *info);
 
 
+/** @brief Decode a block of RETR data
+ *
+ * @param data raw message data as received from the server
+ * @param count number of bytes in data
+ * @param state decoder state, initialise to @ref NET_CLIENT_POP_DEC_BOL for a new message
+ * @param msg_buf buffer to which the decoded data is appended
+ * @param lines incremented by the number of complete lines appended to msg_buf
+ * @return the number of bytes of data which have been consumed
+ *
+ * Remove the CR of all CRLF line terminators and the stuffed '.' at the beginning of lines, and detect the terminating ".\r\n"
+ * line.  The state is carried over to the next call, so the block boundaries are arbitrary.  The function returns early when
+ * msg_buf ends with a complete line and holds at least @ref NET_CLIENT_BLOCK_SIZE bytes, or when the terminating line has been
+ * read.  This function is used by net_client_pop_retr() and exported only for the test program.
+ */
+gsize net_client_pop_decode_block(const gchar          *data,
+								  gsize                 count,
+								  NetClientPopDecState *state,
+								  GString              *msg_buf,
+								  gsize                *lines);
+
+
 /** @file
  *
  * This module implements a POP3 client class conforming with <a href="https://tools.ietf.org/html/rfc1939">RFC 1939</a>.
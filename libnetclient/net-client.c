@@ -298,6 +298,61 @@ net_client_read_line(NetClient *client, gchar **recv_line, GError **error)
 }
 
 
+gboolean
+net_client_peek_buffer(NetClient *client, const gchar **buffer, gsize *count, GError **error)
+{
+	/*lint -e{9079}		(MISRA C:2012 Rule 11.5) intended use of this function */
+	const NetClientPrivate *priv = net_client_get_instance_private(client);
+	gboolean result = FALSE;
+
+	g_return_val_if_fail(NET_IS_CLIENT(client) && (buffer != NULL) && (count != NULL), FALSE);
+
+	if (priv->istream == NULL) {
+		g_set_error(error, NET_CLIENT_ERROR_QUARK, (gint) NET_CLIENT_ERROR_NOT_CONNECTED, _("network client is not connected"));
+	} else {
+		GBufferedInputStream *bstream = G_BUFFERED_INPUT_STREAM(priv->istream);
+		gssize avail;
+
+		if (g_buffered_input_stream_get_buffer_size(bstream) < NET_CLIENT_BLOCK_SIZE) {
+			g_buffered_input_stream_set_buffer_size(bstream, NET_CLIENT_BLOCK_SIZE);
+		}
+		avail = (gssize) g_buffered_input_stream_get_available(bstream);
+		if (avail == 0) {
+			GError *read_err = NULL;
+
+			avail = g_buffered_input_stream_fill(bstream, -1, NULL, &read_err);
+			if (avail < 0) {
+				g_propagate_error(error, read_err);
+			} else if (avail == 0) {
+				g_set_error(error, NET_CLIENT_ERROR_QUARK, (gint) NET_CLIENT_ERROR_CONNECTION_LOST, _("connection lost"));
+			} else {
+				/* nothing to do (see MISRA C:2012, Rule 15.7) */
+			}
+		}
+		if (avail > 0) {
+			*buffer = g_buffered_input_stream_peek_buffer(bstream, count);
+			result = TRUE;
+		}
+	}
+
+	return result;
+}
+
+
+void
+net_client_skip_buffer(NetClient *client, gsize count)
+{
+	/*lint -e{9079}		(MISRA C:2012 Rule 11.5) intended use of this function */
+	const NetClientPrivate *priv = net_client_get_instance_private(client);
+
+	g_return_if_fail(NET_IS_CLIENT(client) && (priv->istream != NULL) &&
+		(count <= g_buffered_input_stream_get_available(G_BUFFERED_INPUT_STREAM(priv->istream))));
+
+	/* skipping buffered data never blocks and cannot fail */
+	(void) g_input_stream_skip(G_INPUT_STREAM(priv->istream), count, NULL, NULL);
+}
+
+
 gboolean
 net_client_write_buffer(NetClient *client, const gchar *buffer, gsize count, GError **error)
 {
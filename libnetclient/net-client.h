@@ -31,6 +31,10 @@ G_DECLARE_DERIVABLE_TYPE(NetClient, net_client, NET, CLIENT, GObject)
 #define NET_CLIENT_ERROR_QUARK				(g_quark_from_static_string("net-client"))
 
 
+/** Size of the internal input buffer used by net_client_peek_buffer(). */
+#define NET_CLIENT_BLOCK_SIZE				65536U
+
+
 struct _NetClientClass {
     GObjectClass parent;
 };
@@ -216,6 +220,33 @@ gboolean net_client_start_compression(NetClient *client, GError **error);
 gboolean net_client_read_line(NetClient *client, gchar **recv_line, GError **error);
 
 
+/** @brief Peek at the buffered input data of a network client
+ *
+ * @param client network client
+ * @param buffer filled with a pointer to the internal input buffer on success
+ * @param count filled with the number of bytes available in the buffer on success
+ * @param error filled with error information on error
+ * @return TRUE if at least one byte is available, FALSE on error
+ *
+ * Return the data which is available in the client's internal input buffer, reading up to @ref NET_CLIENT_BLOCK_SIZE bytes from
+ * the remote server if the buffer is empty.  The data is @em not consumed, call net_client_skip_buffer() to do so.  This function
+ * is intended for protocol decoders which process large data blocks without splitting them into lines.
+ *
+ * @note The returned buffer is owned by the client and is valid only until the next read operation.  It is not NUL-terminated.
+ */
+gboolean net_client_peek_buffer(NetClient *client, const gchar **buffer, gsize *count, GError **error);
+
+
+/** @brief Consume buffered input data of a network client
+ *
+ * @param client network client
+ * @param count number of bytes to consume, which must not exceed the count returned by net_client_peek_buffer()
+ *
+ * Remove the passed number of bytes from the client's internal input buffer.
+ */
+void net_client_skip_buffer(NetClient *client, gsize count);
+
+
 /** @brief Write data to a network client
  *
  * @param client network client
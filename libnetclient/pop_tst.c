@@ -0,0 +1,176 @@
+/* NetClient - simple line-based network client library
+ *
+ * Copyright (C) Albrecht Dreß <mailto:albrecht.dress@arcor.de> 2017 - 2020
+ *
+ * This library is free software; you can redistribute it and/or modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License along with this library. If not, see
+ * <https://www.gnu.org/licenses/>.
+ */
+
+/** @file pop_tst.c tests the POP3 RETR decoder offline.  Each message is decoded in one block, split at every possible position,
+ * and in blocks of one byte, to check that the decoder state is carried over correctly. */
+
+#include <stdio.h>
+#include <string.h>
+#include "net-client-pop.h"
+
+
+/* data which follows the terminating line, and which must not be consumed */
+#define NEXT_RESPONSE				"+OK next\r\n"
+
+
+/* Decode wire data, passed to the decoder in blocks of at most block_size bytes, and flush the message buffer as
+ * net_client_pop_retr() does.  Returns TRUE if the terminating line has been found. */
+static gboolean
+decode_blocks(const gchar *data, gsize count, gsize first_block, gsize block_size, GString *decoded, gsize *lines,
+			  gsize *consumed)
+{
+	NetClientPopDecState state;
+	GString *msg_buf;
+	gsize pos;
+
+	state = NET_CLIENT_POP_DEC_BOL;
+	msg_buf = g_string_new(NULL);
+	pos = 0U;
+	*lines = 0U;
+	while ((pos < count) && (state != NET_CLIENT_POP_DEC_DONE)) {
+		gsize block;
+
+		block = (pos < first_block) ? (first_block - pos) : block_size;
+		block = MIN(block, count - pos);
+		pos += net_client_pop_decode_block(&data[pos], block, &state, msg_buf, lines);
+		if ((state == NET_CLIENT_POP_DEC_BOL) && (msg_buf->len >= NET_CLIENT_BLOCK_SIZE)) {
+			g_string_append_len(decoded, msg_buf->str, msg_buf->len);
+			g_string_truncate(msg_buf, 0U);
+		}
+	}
+	g_string_append_len(decoded, msg_buf->str, msg_buf->len);
+	g_string_free(msg_buf, TRUE);
+	*consumed = pos;
+
+	return state == NET_CLIENT_POP_DEC_DONE;
+}
+
+
+static int
+check_decoder(const gchar *name, const gchar *message, const gchar *reference, gsize ref_lines, gsize first_block,
+			  gsize block_size)
+{
+	gchar *wire;
+	gsize wire_len;
+	GString *decoded;
+	gsize lines;
+	gsize consumed;
+	gboolean done;
+	int failure_count = 0;
+
+	wire = g_strconcat(message, NEXT_RESPONSE, NULL);
+	wire_len = strlen(wire);
+	decoded = g_string_new(NULL);
+	done = decode_blocks(wire, wire_len, first_block, block_size, decoded, &lines, &consumed);
+	if (!done) {
+		printf("%s, blocks %zu/%zu: terminating line not found\n", name, first_block, block_size);
+		failure_count++;
+	} else if (consumed != strlen(message)) {
+		printf("%s, blocks %zu/%zu: consumed %zu bytes, expected %zu\n", name, first_block, block_size, consumed,
+			   strlen(message));
+		failure_count++;
+	} else if ((strcmp(decoded->str, reference) != 0) || (lines != ref_lines)) {
+		printf("%s, blocks %zu/%zu: decoded %zu lines “%s”, expected %zu lines “%s”\n", name, first_block, block_size,
+			   lines, decoded->str, ref_lines, reference);
+		failure_count++;
+	} else {
+		/* nothing to do, see MISRA C:2012, Rule 15.7 */
+	}
+	g_string_free(decoded, TRUE);
+	g_free(wire);
+
+	return failure_count;
+}
+
+
+static int
+test_decoder(const gchar *name, const gchar *message, const gchar *reference, gsize ref_lines)
+{
+	gsize msg_len = strlen(message);
+	gsize split;
+	int failure_count;
+
+	failure_count = check_decoder(name, message, reference, ref_lines, G_MAXSIZE, G_MAXSIZE);
+	for (split = 1U; (failure_count == 0) && (split < msg_len); split++) {
+		failure_count += check_decoder(name, message, reference, ref_lines, split, G_MAXSIZE);
+	}
+	if (failure_count == 0) {
+		failure_count += check_decoder(name, message, reference, ref_lines, 1U, 1U);
+	}
+
+	return failure_count;
+}
+
+
+/* a message which is larger than the decoder's buffer, with stuffed lines and a line across the buffer limit */
+static int
+test_decoder_large(void)
+{
+	GString *message;
+	GString *reference;
+	guint n;
+	int failure_count;
+
+	message = g_string_new(NULL);
+	reference = g_string_new(NULL);
+	for (n = 0U; n < 3000U; n++) {
+		if ((n % 7U) == 0U) {
+			g_string_append_printf(message, "..stuffed line %u\r\n", n);
+			g_string_append_printf(reference, ".stuffed line %u\n", n);
+		} else {
+			g_string_append_printf(message, "line %u: %s\r\n", n, "The quick brown fox jumps over the lazy dog.");
+			g_string_append_printf(reference, "line %u: %s\n", n, "The quick brown fox jumps over the lazy dog.");
+		}
+	}
+	g_string_append(message, ".\r\n");
+	failure_count = check_decoder("large", message->str, reference->str, 3000U, G_MAXSIZE, G_MAXSIZE);
+	failure_count += check_decoder("large", message->str, reference->str, 3000U, 1U, 4093U);
+	failure_count += check_decoder("large", message->str, reference->str, 3000U, NET_CLIENT_BLOCK_SIZE - 1U, 17U);
+	g_string_free(message, TRUE);
+	g_string_free(reference, TRUE);
+
+	return failure_count;
+}
+
+
+int
+main(void)
+{
+	static const struct {
+		const gchar *name;
+		const gchar *message;		/* as sent by the server */
+		const gchar *reference;		/* decoded */
+		gsize lines;
+	} test_messages[] = {
+		{ "empty", ".\r\n", "", 0U },
+		{ "plain", "Subject: test\r\n\r\nbody\r\n.\r\n", "Subject: test\n\nbody\n", 3U },
+		{ "stuffed", "..\r\n...\r\n..x\r\n.\r\n", ".\n..\n.x\n", 3U },
+		{ "bare CR", "a\rb\r\n\r\r\n.\r\n", "a\rb\n\r\n", 2U },
+		{ "dot CR", ".\rx\r\n.\r\n", "\rx\n", 1U },
+		{ "dot inside", "a.\r\n .\r\n.\r\n", "a.\n .\n", 2U }
+	};
+	guint n;
+	int failure_count = 0;
+
+	for (n = 0U; n < G_N_ELEMENTS(test_messages); n++) {
+		failure_count += test_decoder(test_messages[n].name, test_messages[n].message, test_messages[n].reference,
+			test_messages[n].lines);
+	}
+	failure_count += test_decoder_large();
+
+	if (failure_count > 0) {
+		printf("%d POP3 decoder check(s) failed\n", failure_count);
+	}
+	return (failure_count > 0) ? 1 : 0;
+}
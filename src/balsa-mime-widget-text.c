@@ -1444,8 +1444,10 @@ fill_text_buf_cited(BalsaMimeWidgetText *mwt,
     GtkTextBuffer *buffer;
     GdkRGBA *rgba;
     LibBalsaUrlInsertInfo url_info;
+    LibBalsaTextBatch batch;
     guint cite_level;
     guint cite_start;
+    gint buffer_start;
 
     /* prepare citation regular expression for plain bodies */
     if (is_plain) {
@@ -1463,8 +1465,9 @@ fill_text_buf_cited(BalsaMimeWidgetText *mwt,
 
     buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(widget));
     rgba = &balsa_app.url_color;
-    gtk_text_buffer_create_tag(buffer, "url",
-                               "foreground-rgba", rgba, NULL);
+    url_info.url_tag =
+        gtk_text_buffer_create_tag(buffer, "url",
+                                   "foreground-rgba", rgba, NULL);
     gtk_text_buffer_create_tag(buffer, "emphasize",
                                "foreground", "red",
                                "underline", PANGO_UNDERLINE_SINGLE,
@@ -1484,6 +1487,9 @@ fill_text_buf_cited(BalsaMimeWidgetText *mwt,
     url_info.buffer_is_flowed = is_flowed;
     url_info.ml_url_buffer = NULL;
 
+    /* collect the text and its tags, and insert them in one go */
+    libbalsa_text_batch_init(&batch);
+    buffer_start = gtk_text_buffer_get_char_count(buffer);
     cite_level = 0;
     cite_start = 0;
     while (*text_body) {
@@ -1499,8 +1505,8 @@ fill_text_buf_cited(BalsaMimeWidgetText *mwt,
             guint cite_idx;
 
             /* get the cite level only for text/plain parts */
-            libbalsa_match_regex(text_body, rex, &quote_level,
-                                 &cite_idx);
+            libbalsa_match_regex_len(text_body, line_end - text_body, rex,
+                                     &quote_level, &cite_idx);
 
             /* check if the citation level changed */
             if (cite_level != quote_level) {
@@ -1508,34 +1514,29 @@ fill_text_buf_cited(BalsaMimeWidgetText *mwt,
                     cite_bar_t * cite_bar = g_new0(cite_bar_t, 1);
 
                     cite_bar->start_offs = cite_start;
-                    cite_bar->end_offs = gtk_text_buffer_get_char_count(buffer);
+                    cite_bar->end_offs = buffer_start + batch.n_chars;
                     cite_bar->depth = cite_level;
                     mwt->cite_bar_list =
                         g_list_prepend(mwt->cite_bar_list, cite_bar);
                 }
                 if (quote_level > 0)
-                    cite_start = gtk_text_buffer_get_char_count(buffer);
+                    cite_start = buffer_start + batch.n_chars;
                 cite_level = quote_level;
             }
 
             /* skip the citation prefix */
             tag = quote_tag(buffer, quote_level, mwt->cite_bar_dimension);
             if (quote_level) {
-                GtkTextIter cite_iter;
-
-                gtk_text_buffer_get_iter_at_mark(buffer, &cite_iter,
-                                                 gtk_text_buffer_get_insert(buffer));
-                gtk_text_buffer_insert_with_tags(buffer, &cite_iter,
-                                                 text_body,
-                                                 cite_idx,
-                                                 tag, mwt->invisible, NULL);
+                libbalsa_text_batch_append(&batch, text_body, cite_idx,
+                                           tag, mwt->invisible);
                 text_body += cite_idx;
 
                 /* append a zero-width space if the remainder of the line is
                  * empty, as otherwise the line is not visible (i.e.
                  * completely 0.01 pts high)... */
                 if (text_body == line_end || *text_body == '\r')
-                    gtk_text_buffer_insert_at_cursor(buffer, "\xE2\x80\x8B", 3);
+                    libbalsa_text_batch_append(&batch, "\xE2\x80\x8B", 3,
+                                               NULL, NULL);
             }
         }
 
@@ -1544,12 +1545,13 @@ fill_text_buf_cited(BalsaMimeWidgetText *mwt,
             --len;
         /* tag is NULL if the line isn't quoted, but it causes
          * no harm */
-        if (!libbalsa_insert_with_url(buffer, text_body, len,
+        if (!libbalsa_insert_with_url(&batch, text_body, len,
                                       tag, &url_info))
-            gtk_text_buffer_insert_at_cursor(buffer, "\n", 1);
+            libbalsa_text_batch_append(&batch, "\n", 1, NULL, NULL);
 
         text_body = *line_end ? line_end + 1 : line_end;
     }
+    libbalsa_text_batch_apply(&batch, buffer, &url_info);
 
     /* add any pending cited part */
     if (cite_level > 0) {
@@ -3623,6 +3623,108 @@ bw_mailbox_check(LibBalsaMailbox * mailbox, struct check_messages_thread_info *i
     libbalsa_mailbox_check(mailbox);
 }
 
+/* Parallel check of the mailboxes in the list: the mailboxes are grouped
+ * by the server they live on (all local mailboxes form one group), and
+ * the groups are checked concurrently by a bounded thread pool, so one
+ * slow server does not delay the check of all others.  Within a group,
+ * at most BW_CHECK_MAX_PER_SERVER mailboxes are checked at the same time.
+ * A hung server blocks only the workers of its own group, until the
+ * network layer times out. */
+#define BW_CHECK_MAX_THREADS            8
+#define BW_CHECK_MAX_PER_SERVER         2
+
+typedef struct {
+    GMutex lock;
+    GSList *mailboxes;          /* not referenced */
+    guint workers;
+} bw_check_group_t;
+
+static void
+bw_check_group_free(bw_check_group_t *group)
+{
+    g_mutex_clear(&group->lock);
+    g_slist_free(group->mailboxes);
+    g_free(group);
+}
+
+static void
+bw_check_group_worker(bw_check_group_t *group, struct check_messages_thread_info *info)
+{
+    for (;;) {
+        LibBalsaMailbox *mailbox;
+
+        g_mutex_lock(&group->lock);
+        if (group->mailboxes == NULL) {
+            g_mutex_unlock(&group->lock);
+            break;
+        }
+        mailbox = LIBBALSA_MAILBOX(group->mailboxes->data);
+        group->mailboxes = g_slist_delete_link(group->mailboxes, group->mailboxes);
+        g_mutex_unlock(&group->lock);
+
+        bw_mailbox_check(mailbox, info);
+    }
+}
+
+static guint
+bw_check_group_max_workers(LibBalsaMailbox *mailbox)
+{
+    if (LIBBALSA_IS_MAILBOX_IMAP(mailbox)) {
+        LibBalsaServer *server = LIBBALSA_MAILBOX_REMOTE_GET_SERVER(mailbox);
+        gint max_conn;
+
+        /* leave one connection for the user interface */
+        max_conn = libbalsa_imap_server_get_max_connections(LIBBALSA_IMAP_SERVER(server)) - 1;
+        return CLAMP(max_conn, 1, BW_CHECK_MAX_PER_SERVER);
+    }
+
+    return BW_CHECK_MAX_PER_SERVER;
+}
+
+static void
+bw_check_mailboxes_parallel(struct check_messages_thread_info *info, GSList *list)
+{
+    GHashTable *groups;
+    GHashTableIter iter;
+    gpointer value;
+    GThreadPool *pool;
+
+    /* group the mailboxes by server, keeping their order */
+    groups = g_hash_table_new_full(NULL, NULL, NULL, (GDestroyNotify) bw_check_group_free);
+    for (list = g_slist_reverse(g_slist_copy(list)); list != NULL; list = g_slist_delete_link(list, list)) {
+        LibBalsaMailbox *mailbox = LIBBALSA_MAILBOX(list->data);
+        gpointer key;
+        bw_check_group_t *group;
+
+        key = LIBBALSA_IS_MAILBOX_REMOTE(mailbox) ? (gpointer) LIBBALSA_MAILBOX_REMOTE_GET_SERVER(mailbox) : NULL;
+        group = g_hash_table_lookup(groups, key);
+        if (group == NULL) {
+            group = g_new0(bw_check_group_t, 1);
+            g_mutex_init(&group->lock);
+            group->workers = bw_check_group_max_workers(mailbox);
+            g_hash_table_insert(groups, key, group);
+        }
+        group->mailboxes = g_slist_prepend(group->mailboxes, mailbox);
+    }
+
+    pool = g_thread_pool_new((GFunc) bw_check_group_worker, info, BW_CHECK_MAX_THREADS, FALSE, NULL);
+    g_hash_table_iter_init(&iter, groups);
+    while (g_hash_table_iter_next(&iter, NULL, &value)) {
+        bw_check_group_t *group = (bw_check_group_t *) value;
+        guint workers;
+        guint n;
+
+        workers = MIN(group->workers, g_slist_length(group->mailboxes));
+        for (n = 0U; n < workers; n++) {
+            g_thread_pool_push(pool, group, NULL);
+        }
+    }
+
+    /* wait until all groups have been checked */
+    g_thread_pool_free(pool, FALSE, TRUE);
+    g_hash_table_destroy(groups);
+}
+
 static gboolean
 bw_check_messages_thread_idle_cb(BalsaWindow * window)
 {
@@ -3648,7 +3750,7 @@ bw_check_messages_thread(struct check_messages_thread_info *info)
     	if (info->with_progress_dialog) {
     		libbalsa_progress_dialog_ensure(&progress_dialog, _("Checking Mail…"), GTK_WINDOW(info->window), _("Mailboxes"));
     	}
-    	g_slist_foreach(list, (GFunc) bw_mailbox_check, info);
+    	bw_check_mailboxes_parallel(info, list);
     	g_slist_free_full(list, g_object_unref);
     	if (info->with_progress_dialog) {
     		libbalsa_progress_dialog_update(&progress_dialog, _("Mailboxes"), TRUE, 1.0, NULL);
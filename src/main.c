@@ -598,6 +598,7 @@ balsa_activate_cb(GApplication *application,
     /* load mailboxes */
     config_load_sections();
     mailboxes_init(cmd_get_stats);
+    sendmsg_window_recover_journals();
 }
 
 /*
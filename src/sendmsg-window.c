@@ -91,6 +91,8 @@ typedef struct {
 typedef enum { QUOTE_HEADERS, QUOTE_ALL, QUOTE_NOPREFIX } QuoteType;
 
 static gint message_postpone(BalsaSendmsg * bsmsg);
+static void sw_journal_remove(BalsaSendmsg * bsmsg);
+static void strip_chars(gchar * str, const gchar * char2strip);
 
 static void balsa_sendmsg_destroy_handler(BalsaSendmsg * bsmsg);
 static void check_readiness(BalsaSendmsg * bsmsg);
@@ -99,6 +101,9 @@ static void bsmsg_setup_gpg_ui(BalsaSendmsg *bsmsg);
 static void bsmsg_update_gpg_ui_on_ident_change(BalsaSendmsg *bsmsg,
                                                 LibBalsaIdentity *new_ident);
 static void bsmsg_setup_gpg_ui_by_mode(BalsaSendmsg *bsmsg, guint mode);
+#ifdef ENABLE_AUTOCRYPT
+static void sw_autocrypt_schedule(BalsaSendmsg *bsmsg);
+#endif                          /* ENABLE_AUTOCRYPT */
 
 #if !HAVE_GSPELL && !HAVE_GTKSPELL
 static void sw_spell_check_weak_notify(BalsaSendmsg * bsmsg);
@@ -492,9 +497,10 @@ delete_handler(BalsaSendmsg * bsmsg)
 
     switch (reply) {
     case GTK_RESPONSE_YES:
-        if (bsmsg->state == SENDMSG_STATE_MODIFIED)
-            if (!message_postpone(bsmsg))
-                return TRUE;
+        /* An autosave wrote only the journal, so save the draft in
+         * either state. */
+        if (!message_postpone(bsmsg))
+            return TRUE;
         break;
     case GTK_RESPONSE_NO:
         if (!bsmsg->is_continue)
@@ -597,6 +603,21 @@ balsa_sendmsg_destroy_handler(BalsaSendmsg * bsmsg)
 #endif                          /* HAVE_GTKSPELL */
     if (bsmsg->autosave_timeout_id != 0)
         g_source_remove(bsmsg->autosave_timeout_id);
+    sw_journal_remove(bsmsg);
+    g_object_unref(bsmsg->journal_cancel);
+
+#ifdef ENABLE_AUTOCRYPT
+    if (bsmsg->autocrypt_timeout_id != 0)
+        g_source_remove(bsmsg->autocrypt_timeout_id);
+    if (bsmsg->autocrypt_cancel != NULL) {
+        /* the callback must not touch bsmsg any more */
+        g_cancellable_cancel(bsmsg->autocrypt_cancel);
+        g_object_unref(bsmsg->autocrypt_cancel);
+    }
+    g_free(bsmsg->autocrypt_recipients);
+    g_list_free_full(bsmsg->autocrypt_missing_keys,
+                     (GDestroyNotify) g_bytes_unref);
+#endif                          /* ENABLE_AUTOCRYPT */
 
 #if !HAVE_GTKSOURCEVIEW
     g_object_unref(bsmsg->buffer2);
@@ -1312,6 +1333,9 @@ update_bsmsg_identity(BalsaSendmsg* bsmsg, LibBalsaIdentity* ident)
     g_free(message_text);
 
     libbalsa_address_view_set_domain(bsmsg->recipient_view, libbalsa_identity_get_domain(ident));
+#ifdef ENABLE_AUTOCRYPT
+    sw_autocrypt_schedule(bsmsg);
+#endif                          /* ENABLE_AUTOCRYPT */
 
     sw_action_set_active(bsmsg, "request-mdn", libbalsa_identity_get_request_mdn(ident));
     sw_action_set_active(bsmsg, "request-dsn", libbalsa_identity_get_request_dsn(ident));
@@ -2556,6 +2580,16 @@ create_info_pane(BalsaSendmsg * bsmsg)
                              (GTK_TREE_VIEW(bsmsg->recipient_view)),
                              "row-deleted",
                              G_CALLBACK(sendmsg_window_set_title), bsmsg);
+#ifdef ENABLE_AUTOCRYPT
+    g_signal_connect_swapped(gtk_tree_view_get_model
+                             (GTK_TREE_VIEW(bsmsg->recipient_view)),
+                             "row-changed",
+                             G_CALLBACK(sw_autocrypt_schedule), bsmsg);
+    g_signal_connect_swapped(gtk_tree_view_get_model
+                             (GTK_TREE_VIEW(bsmsg->recipient_view)),
+                             "row-deleted",
+                             G_CALLBACK(sw_autocrypt_schedule), bsmsg);
+#endif                          /* ENABLE_AUTOCRYPT */
 
     /* Subject: */
     create_string_header(bsmsg, grid, _("S_ubject:"), ++row,
@@ -3965,6 +3999,7 @@ sw_save_draft(BalsaSendmsg * bsmsg)
 	g_object_unref(bsmsg->draft_message);
     }
     bsmsg->state = SENDMSG_STATE_CLEAN;
+    sw_journal_remove(bsmsg);
 
     bsmsg->draft_message =
 	libbalsa_mailbox_get_message(balsa_app.draftbox,
@@ -3979,12 +4014,254 @@ sw_save_draft(BalsaSendmsg * bsmsg)
     return TRUE;
 }
 
+/*
+ * Autosave journal
+ *
+ * Autosaving does not save a complete draft, as building the MIME
+ * message re-encodes all attachments, and saving it may rewrite the
+ * whole draftbox.  Instead, the headers and the text are written to a
+ * per-window journal file by a worker thread.  The journal is removed
+ * when the message is saved, postponed or the window is closed, so a
+ * journal is left only if Balsa did not exit cleanly; it is moved to the
+ * draftbox by sendmsg_window_recover_journals() on the next start.
+ */
+#define SW_JOURNAL_DIR "compose-journal"
+
+typedef struct {
+    gchar *path;
+    GCancellable *cancel;
+    gchar *headers[5];          /* From, To, Cc, Bcc, Reply-To */
+    gchar *subject;
+    gchar *in_reply_to;
+    gchar *text;
+} SwJournalData;
+
+static const gchar *sw_journal_headers[] =
+    { "From", "To", "Cc", "Bcc", "Reply-To" };
+
+/* Serialises writing and removing journal files. */
+G_LOCK_DEFINE_STATIC(sw_journal);
+
+static gchar *
+sw_journal_dir(void)
+{
+    return g_build_filename(g_get_user_state_dir(), "balsa",
+                            SW_JOURNAL_DIR, NULL);
+}
+
+static gchar *
+sw_journal_address_string(LibBalsaAddressView * view, const gchar * type)
+{
+    InternetAddressList *list;
+    gchar *str = NULL;
+
+    list = libbalsa_address_view_get_list(view, type);
+    if (internet_address_list_length(list) > 0)
+        str = internet_address_list_to_string(list, NULL, FALSE);
+    g_object_unref(list);
+
+    return str;
+}
+
+static void
+sw_journal_data_free(SwJournalData * data)
+{
+    guint i;
+
+    g_free(data->path);
+    g_object_unref(data->cancel);
+    for (i = 0; i < G_N_ELEMENTS(data->headers); i++)
+        g_free(data->headers[i]);
+    g_free(data->subject);
+    g_free(data->in_reply_to);
+    g_free(data->text);
+    g_free(data);
+}
+
+static gpointer
+sw_journal_thread(SwJournalData * data)
+{
+    GMimeMessage *message;
+    GMimeTextPart *part;
+    GDateTime *now;
+    GMimeStream *stream;
+    GByteArray *bytes;
+    gchar *dir;
+    GError *err = NULL;
+    guint i;
+
+    message = g_mime_message_new(TRUE);
+    for (i = 0; i < G_N_ELEMENTS(data->headers); i++) {
+        if (data->headers[i] != NULL)
+            g_mime_object_set_header(GMIME_OBJECT(message),
+                                     sw_journal_headers[i],
+                                     data->headers[i], "UTF-8");
+    }
+    if (data->subject != NULL)
+        g_mime_message_set_subject(message, data->subject, "UTF-8");
+    if (data->in_reply_to != NULL)
+        g_mime_object_set_header(GMIME_OBJECT(message), "In-Reply-To",
+                                 data->in_reply_to, NULL);
+    now = g_date_time_new_now_local();
+    g_mime_message_set_date(message, now);
+    g_date_time_unref(now);
+
+    part = g_mime_text_part_new_with_subtype("plain");
+    g_mime_text_part_set_text(part, data->text);
+    g_mime_message_set_mime_part(message, GMIME_OBJECT(part));
+    g_object_unref(part);
+
+    bytes = g_byte_array_new();
+    stream = g_mime_stream_mem_new_with_byte_array(bytes);
+    g_mime_stream_mem_set_owner(GMIME_STREAM_MEM(stream), FALSE);
+    g_mime_object_write_to_stream(GMIME_OBJECT(message), NULL, stream);
+    g_object_unref(stream);
+    g_object_unref(message);
+
+    dir = sw_journal_dir();
+    G_LOCK(sw_journal);
+    if (!g_cancellable_is_cancelled(data->cancel)) {
+        if (g_mkdir_with_parents(dir, 0700) != 0 ||
+            !g_file_set_contents(data->path, (const gchar *) bytes->data,
+                                 bytes->len, &err)) {
+            libbalsa_information(LIBBALSA_INFORMATION_WARNING,
+                                 _("Could not autosave message: %s"),
+                                 err != NULL ? err->message : g_strerror(errno));
+            g_clear_error(&err);
+        }
+    }
+    G_UNLOCK(sw_journal);
+    g_free(dir);
+
+    g_byte_array_free(bytes, TRUE);
+    sw_journal_data_free(data);
+
+    return NULL;
+}
+
+/* Collect the headers and the text in the main thread, and write them
+ * to the journal in a worker thread. */
+static void
+sw_journal_save(BalsaSendmsg * bsmsg)
+{
+    SwJournalData *data;
+    GtkTextBuffer *buffer;
+    GtkTextIter start, end;
+
+    if (bsmsg->journal_path == NULL) {
+        static guint journal_count = 0;
+        gchar *dir;
+        gchar *name;
+
+        dir = sw_journal_dir();
+        name = g_strdup_printf("%d-%u", (int) getpid(), ++journal_count);
+        bsmsg->journal_path = g_build_filename(dir, name, NULL);
+        g_free(name);
+        g_free(dir);
+    }
+
+    data = g_new0(SwJournalData, 1);
+    data->path = g_strdup(bsmsg->journal_path);
+    data->cancel = g_object_ref(bsmsg->journal_cancel);
+    data->headers[0] =
+        internet_address_to_string(libbalsa_identity_get_address(bsmsg->ident),
+                                   NULL, FALSE);
+    data->headers[1] =
+        sw_journal_address_string(bsmsg->recipient_view, "To:");
+    data->headers[2] =
+        sw_journal_address_string(bsmsg->recipient_view, "CC:");
+    data->headers[3] =
+        sw_journal_address_string(bsmsg->recipient_view, "BCC:");
+    data->headers[4] =
+        sw_journal_address_string(bsmsg->replyto_view, "Reply To:");
+    data->subject =
+        gtk_editable_get_chars(GTK_EDITABLE(bsmsg->subject.body), 0, -1);
+    strip_chars(data->subject, "\r\n");
+    data->in_reply_to = g_strdup(bsmsg->in_reply_to);
+
+    buffer = gtk_text_view_get_buffer(GTK_TEXT_VIEW(bsmsg->text));
+    gtk_text_buffer_get_bounds(buffer, &start, &end);
+    data->text = gtk_text_iter_get_text(&start, &end);
+
+    g_thread_unref(g_thread_new("sw_journal", (GThreadFunc) sw_journal_thread, data));
+}
+
+/* Remove the journal; a write which is still pending is dropped. */
+static void
+sw_journal_remove(BalsaSendmsg * bsmsg)
+{
+    g_cancellable_cancel(bsmsg->journal_cancel);
+    g_object_unref(bsmsg->journal_cancel);
+    bsmsg->journal_cancel = g_cancellable_new();
+
+    if (bsmsg->journal_path != NULL) {
+        G_LOCK(sw_journal);
+        g_unlink(bsmsg->journal_path);
+        G_UNLOCK(sw_journal);
+        g_free(bsmsg->journal_path);
+        bsmsg->journal_path = NULL;
+    }
+}
+
+/* Move journals left over by a previous session to the draftbox. */
+void
+sendmsg_window_recover_journals(void)
+{
+    gchar *dir_name;
+    GDir *dir;
+    const gchar *name;
+    guint recovered = 0;
+
+    if (balsa_app.draftbox == NULL)
+        return;
+
+    dir_name = sw_journal_dir();
+    dir = g_dir_open(dir_name, 0, NULL);
+    if (dir == NULL) {
+        g_free(dir_name);
+        return;
+    }
+
+    while ((name = g_dir_read_name(dir)) != NULL) {
+        gchar *path;
+        GMimeStream *stream;
+        int fd;
+        GError *err = NULL;
+
+        path = g_build_filename(dir_name, name, NULL);
+        fd = g_open(path, O_RDONLY, 0);
+        if (fd >= 0) {
+            stream = g_mime_stream_fs_new(fd);
+            if (libbalsa_mailbox_add_message(balsa_app.draftbox, stream,
+                                             0, &err)) {
+                g_unlink(path);
+                recovered++;
+            } else {
+                libbalsa_information(LIBBALSA_INFORMATION_WARNING,
+                                     _("Could not recover autosaved message %s: %s"),
+                                     path, err != NULL ? err->message : "?");
+                g_clear_error(&err);
+            }
+            g_object_unref(stream);
+        }
+        g_free(path);
+    }
+    g_dir_close(dir);
+    g_free(dir_name);
+
+    if (recovered > 0)
+        libbalsa_information(LIBBALSA_INFORMATION_MESSAGE,
+                             ngettext("%u autosaved message was recovered to the Draftbox.",
+                                      "%u autosaved messages were recovered to the Draftbox.",
+                                      recovered), recovered);
+}
+
 static gboolean
 sw_autosave_timeout_cb(BalsaSendmsg * bsmsg)
 {
     if (bsmsg->state == SENDMSG_STATE_MODIFIED) {
-        if (sw_save_draft(bsmsg))
-            bsmsg->state = SENDMSG_STATE_AUTO_SAVED;
+        sw_journal_save(bsmsg);
+        bsmsg->state = SENDMSG_STATE_AUTO_SAVED;
     }
 
     return TRUE;                /* do repeat it */
@@ -5341,11 +5618,115 @@ import_autocrypt_keys(GList *missing_keys, GError **error)
 	return result;
 }
 
+/* All To: and Cc: addresses, plus the address of the current identity,
+ * which validates that we have a key for it. */
+static InternetAddressList *
+sw_autocrypt_check_list(BalsaSendmsg *bsmsg)
+{
+    InternetAddressList *check_list;
+    InternetAddressList *tmp_list;
+
+    check_list = libbalsa_address_view_get_list(bsmsg->recipient_view, "To:");
+    tmp_list = libbalsa_address_view_get_list(bsmsg->recipient_view, "CC:");
+    internet_address_list_append(check_list, tmp_list);
+    g_object_unref(tmp_list);
+    internet_address_list_add(check_list, libbalsa_identity_get_address(bsmsg->ident));
+
+    return check_list;
+}
+
+/* Forget the cached recommendation. */
+static void
+sw_autocrypt_clear(BalsaSendmsg *bsmsg)
+{
+    if (bsmsg->autocrypt_cancel != NULL) {
+        g_cancellable_cancel(bsmsg->autocrypt_cancel);
+        g_clear_object(&bsmsg->autocrypt_cancel);
+    }
+    g_clear_pointer(&bsmsg->autocrypt_recipients, g_free);
+    bsmsg->autocrypt_mode = AUTOCRYPT_ENCR_ERROR;
+    g_list_free_full(bsmsg->autocrypt_missing_keys,
+                     (GDestroyNotify) g_bytes_unref);
+    bsmsg->autocrypt_missing_keys = NULL;
+}
+
+static void
+sw_autocrypt_recommendation_cb(GObject      *source_object,
+                               GAsyncResult *res,
+                               gpointer      data)
+{
+    BalsaSendmsg *bsmsg = data;
+    AutocryptRecommend autocrypt_mode;
+    GList *missing_keys = NULL;
+    GError *error = NULL;
+
+    autocrypt_mode =
+        autocrypt_recommendation_finish(res, &missing_keys, &error);
+    if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+        /* superseded, or the window is gone */
+        g_error_free(error);
+        return;
+    }
+
+    /* On error, check_autocrypt_recommendation() repeats the check and
+     * reports it. */
+    g_clear_error(&error);
+    g_clear_object(&bsmsg->autocrypt_cancel);
+    bsmsg->autocrypt_mode = autocrypt_mode;
+    bsmsg->autocrypt_missing_keys = missing_keys;
+}
+
+static gboolean
+sw_autocrypt_timeout_cb(BalsaSendmsg *bsmsg)
+{
+    InternetAddressList *check_list;
+    gchar *recipients;
+
+    bsmsg->autocrypt_timeout_id = 0;
+
+    if ((bsmsg->ident == NULL) ||
+        (libbalsa_identity_get_autocrypt_mode(bsmsg->ident) == AUTOCRYPT_DISABLE) ||
+        (libbalsa_address_view_n_addresses(bsmsg->recipient_view) <= 0)) {
+        sw_autocrypt_clear(bsmsg);
+        return G_SOURCE_REMOVE;
+    }
+
+    check_list = sw_autocrypt_check_list(bsmsg);
+    recipients = internet_address_list_to_string(check_list, NULL, FALSE);
+    if (g_strcmp0(recipients, bsmsg->autocrypt_recipients) != 0) {
+        sw_autocrypt_clear(bsmsg);
+        bsmsg->autocrypt_recipients = recipients;
+        bsmsg->autocrypt_cancel = g_cancellable_new();
+        autocrypt_recommendation_async(check_list, bsmsg->autocrypt_cancel,
+                                       sw_autocrypt_recommendation_cb, bsmsg);
+    } else {
+        g_free(recipients);
+    }
+    g_object_unref(check_list);
+
+    return G_SOURCE_REMOVE;
+}
+
+/* Handler for changes of the recipients or the identity: compute the
+ * recommendation in the background when the user pauses, so that
+ * sending does not have to wait for the key ring. */
+#define SW_AUTOCRYPT_DELAY 500
+static void
+sw_autocrypt_schedule(BalsaSendmsg *bsmsg)
+{
+    if (bsmsg->autocrypt_timeout_id != 0)
+        g_source_remove(bsmsg->autocrypt_timeout_id);
+    bsmsg->autocrypt_timeout_id =
+        g_timeout_add(SW_AUTOCRYPT_DELAY,
+                      (GSourceFunc) sw_autocrypt_timeout_cb, bsmsg);
+}
+
 static gboolean
 check_autocrypt_recommendation(BalsaSendmsg *bsmsg)
 {
     InternetAddressList *check_list;
     InternetAddressList *tmp_list;
+    gchar *recipients;
     gint len;
     AutocryptRecommend autocrypt_mode;
     GList *missing_keys = NULL;
@@ -5371,13 +5752,19 @@ check_autocrypt_recommendation(BalsaSendmsg *bsmsg)
         return TRUE;
     }
 
-    /* get the Autocrypt recommendation for all To: and Cc: addresses */
-    check_list = libbalsa_address_view_get_list(bsmsg->recipient_view, "To:");
-    tmp_list = libbalsa_address_view_get_list(bsmsg->recipient_view, "CC:");
-    internet_address_list_append(check_list, tmp_list);
-    g_object_unref(tmp_list);
-    internet_address_list_add(check_list, libbalsa_identity_get_address(bsmsg->ident));		/* validates that we have a key for the current identity */
-    autocrypt_mode = autocrypt_recommendation(check_list, &missing_keys, &error);
+    /* get the Autocrypt recommendation for all To: and Cc: addresses,
+     * unless it has already been computed while they were edited */
+    check_list = sw_autocrypt_check_list(bsmsg);
+    recipients = internet_address_list_to_string(check_list, NULL, FALSE);
+    if ((bsmsg->autocrypt_mode != AUTOCRYPT_ENCR_ERROR) &&
+        (g_strcmp0(recipients, bsmsg->autocrypt_recipients) == 0)) {
+        autocrypt_mode = bsmsg->autocrypt_mode;
+        missing_keys = g_list_copy_deep(bsmsg->autocrypt_missing_keys,
+                                        (GCopyFunc) g_bytes_ref, NULL);
+    } else {
+        autocrypt_mode = autocrypt_recommendation(check_list, &missing_keys, &error);
+    }
+    g_free(recipients);
     g_object_unref(check_list);
 
     /* eject on error or disabled */
@@ -5451,6 +5838,8 @@ check_autocrypt_recommendation(BalsaSendmsg *bsmsg)
         	/* import any missing keys */
         	if (missing_keys != NULL) {
         		result = import_autocrypt_keys(missing_keys, &error);
+        		/* the key ring has changed */
+        		sw_autocrypt_clear(bsmsg);
         		if (!result) {
         			libbalsa_information(LIBBALSA_INFORMATION_ERROR, _("Cannot import Autocrypt keys: %s"), error->message);
         			g_clear_error(&error);
@@ -5683,9 +6072,10 @@ message_postpone(BalsaSendmsg * bsmsg)
     g_ptr_array_foreach(headers, (GFunc) g_free, NULL);
     g_ptr_array_free(headers, TRUE);
 
-    if(successp)
+    if(successp) {
         sw_delete_draft(bsmsg);
-    else {
+        sw_journal_remove(bsmsg);
+    } else {
         balsa_information_parented(GTK_WINDOW(bsmsg->window),
                                    LIBBALSA_INFORMATION_ERROR,
                                    _("Could not postpone message: %s"),
@@ -6897,6 +7287,15 @@ sendmsg_window_new()
     bsmsg->attach_pubkey = FALSE;
     bsmsg->autosave_timeout_id = /* autosave every 5 minutes */
         g_timeout_add_seconds(60*5, (GSourceFunc)sw_autosave_timeout_cb, bsmsg);
+    bsmsg->journal_path = NULL;
+    bsmsg->journal_cancel = g_cancellable_new();
+#ifdef ENABLE_AUTOCRYPT
+    bsmsg->autocrypt_timeout_id = 0;
+    bsmsg->autocrypt_cancel = NULL;
+    bsmsg->autocrypt_recipients = NULL;
+    bsmsg->autocrypt_mode = AUTOCRYPT_ENCR_ERROR;
+    bsmsg->autocrypt_missing_keys = NULL;
+#endif                          /* ENABLE_AUTOCRYPT */
 
     bsmsg->draft_message = NULL;
     bsmsg->parent_message = NULL;
@@ -95,6 +95,8 @@ G_BEGIN_DECLS
 #endif                          /* HAVE_GTKSOURCEVIEW */
         gulong insert_text_sig_id;
         guint autosave_timeout_id;
+        gchar *journal_path;            /* autosaved text and headers */
+        GCancellable *journal_cancel;
         SendmsgState state;
         gulong identities_changed_id;
 	gboolean flow;          /* send format=flowed */ 
@@ -114,6 +116,16 @@ G_BEGIN_DECLS
 
         GtkWidget *paned;
         gboolean ready_to_send;
+
+#ifdef ENABLE_AUTOCRYPT
+        /* Autocrypt recommendation, computed while the recipients are
+         * edited: */
+        guint autocrypt_timeout_id;
+        GCancellable *autocrypt_cancel;
+        gchar *autocrypt_recipients;    /* what the result is valid for */
+        gint autocrypt_mode;            /* AutocryptRecommend */
+        GList *autocrypt_missing_keys;
+#endif                          /* ENABLE_AUTOCRYPT */
     };
 
     BalsaSendmsg *sendmsg_window_compose(void);
@@ -147,6 +159,7 @@ G_BEGIN_DECLS
                                                SendType type);
     BalsaToolbarModel *sendmsg_window_get_toolbar_model(void);
     void sendmsg_window_add_action_entries(GActionMap * action_map);
+    void sendmsg_window_recover_journals(void);
 
 G_END_DECLS
 